@@ -185,12 +185,20 @@ void EditorSceneController::ProcessStateChanges(EditorState& state)
 		state.ShouldComputeHeightmap = false;
 	}
 
+	if (state.ShouldSaveHeightmap)
+	{
+		auto filepath = state.GCodeRoot / "design.hm";
+		if (!ar::HeightmapGenerator::Save(filepath, state.HMDescription, state.HeightmapData))
+			AR_ERROR("Error saving heightmap: {0}", filepath.string());
+		state.ShouldSaveHeightmap = false;
+	}
+
 	if (state.ShouldGenerateFaceMillPaths)
 	{
 		ar::PathGenerator::MillingConfig config;
-		
+		config.ChordTolerance = state.FaceMillChordTolerance;
 		auto path = ar::PathGenerator::GenerateFaceMill(config, state.SelectedIntersectableSurfaces);
-		path.ConvertToGCode(1, state.GCodeRoot);
+		path.ConvertToGCode(1, state.GCodeRoot, state.GCodeOptions);
 		state.ShouldGenerateFaceMillPaths = false;
 	}
 
@@ -200,7 +208,7 @@ void EditorSceneController::ProcessStateChanges(EditorState& state)
 		config.Type = ar::ToolType::F10;
 		config.StepY = 0.9f;
 		auto path = ar::PathGenerator::GenerateBaseMill(config, state.SelectedIntersectableSurfaces);
-		path.ConvertToGCode(2, state.GCodeRoot);
+		path.ConvertToGCode(2, state.GCodeRoot, state.GCodeOptions);
 		state.ShouldGenerateBaseMillPaths = false;
 	}
 
@@ -211,7 +219,7 @@ void EditorSceneController::ProcessStateChanges(EditorState& state)
 			ar::PathGenerator::MillingConfig config;
 			config.Type = ar::ToolType::F10;
 			auto path = ar::PathGenerator::GenerateOutlineMill(config, *state.InterpolatedOutline, *state.OutlineStartPoint, state.OutlineStartOffset);
-			path.ConvertToGCode(3, state.GCodeRoot);
+			path.ConvertToGCode(3, state.GCodeRoot, state.GCodeOptions);
 		}
 		state.ShouldGenerateOutlineMillPaths = false;
 	}
@@ -398,6 +398,15 @@ void EditorUI::RenderMillingWindow()
 		else
 			AR_TRACE("Import canceled");
 	}
+	const char* dialectNames[] = { "Numbered", "Plain", "Binary" };
+	int dialect = static_cast<int>(m_State.GCodeOptions.Dialect);
+	if (ImGui::Combo("Output format", &dialect, dialectNames, IM_ARRAYSIZE(dialectNames)))
+		m_State.GCodeOptions.Dialect = static_cast<ar::GCodeDialect>(dialect);
+	{
+		ar::ScopedDisable disable(m_State.GCodeOptions.Dialect == ar::GCodeDialect::Binary);
+		ImGui::Checkbox("Omit unchanged axes", &m_State.GCodeOptions.ElideModalAxes);
+		ImGui::DragFloat("Arc tolerance [mm]", &m_State.GCodeOptions.ArcTolerance, 0.001f, 0.0f, 0.1f, "%.3f");
+	}
 
 	// BASE
 	std::string baseName = (m_State.BaseSurface.has_value()) ?
@@ -475,6 +484,14 @@ void EditorUI::RenderMillingWindow()
 				showImage = !showImage;
 			}
 		}
+		ImGui::SameLine();
+		{
+			ar::ScopedDisable disable(m_State.HeightmapData.empty() || m_State.GCodeRoot.empty());
+			if (ImGui::Button("Save for simulator"))
+			{
+				m_State.ShouldSaveHeightmap = true;
+			}
+		}
 		if (showImage)
 		{
 			auto size = ImGui::GetContentRegionAvail();
@@ -488,6 +505,7 @@ void EditorUI::RenderMillingWindow()
 
 	if (ImGui::CollapsingHeader("Rough milling"))
 	{
+		ImGui::DragFloat("Chord tolerance [cm]", &m_State.FaceMillChordTolerance, 0.001f, 0.001f, 0.1f, "%.3f");
 		if (ImGui::Button("Generate"))
 		{
 			m_State.ShouldGenerateFaceMillPaths = true;
@@ -6,6 +6,7 @@
 #include "core/Geometry/HoleDetector.h"
 #include "core/Drawing/PaintSurface.h"
 #include "core/Paths/HeightmapGenerator.h"
+#include "core/Paths/GCodeWriter.h"
 #include <filesystem>
 
 struct EntityLink
@@ -169,7 +170,9 @@ struct EditorState
 	ar::HeightmapGenerator::HeightmapDesc HMDescription{};
 	std::vector<float> HeightmapData{};
 	ar::Ref<ar::Texture> HeightmapImage = nullptr;
+	bool ShouldSaveHeightmap = false;	// as design.hm in the paths directory, for the simulator's deviation analysis
 	bool ShouldGenerateFaceMillPaths = false;
+	float FaceMillChordTolerance = 0.01f;
 	bool ShouldGenerateBaseMillPaths = false;
 	bool ShouldGenerateOutlineMillPaths = false;
 
@@ -180,6 +183,7 @@ struct EditorState
 
 	// ============================= Rough Milling =============================
 	std::filesystem::path GCodeRoot{};
+	ar::GCodeWriter::Options GCodeOptions{};
 
 	// ============================= Base Milling =============================
 	bool ShowSelectedIntCurveNormals = false;
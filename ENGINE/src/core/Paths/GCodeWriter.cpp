@@ -0,0 +1,173 @@
+#include "arpch.h"
+#include "GCodeWriter.h"
+#include <fmt/compile.h>
+#include <cmath>
+#include <cstring>
+
+namespace ar
+{
+	GCodeWriter::GCodeWriter(const std::filesystem::path& filepath, Options options)
+		: m_Options(options)
+	{
+		m_File.open(filepath, std::ios::binary);
+		m_Buffer.reserve(s_FlushThreshold + 256);
+		if (m_File.is_open() && m_Options.Dialect == GCodeDialect::Binary)
+		{
+			// the count is patched once all moves are known
+			BinaryHeader header;
+			m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		}
+	}
+
+	GCodeWriter::~GCodeWriter()
+	{
+		if (!m_File.is_open())
+			return;
+		Flush();
+		if (m_Options.Dialect == GCodeDialect::Binary)
+		{
+			m_File.seekp(offsetof(BinaryHeader, Count));
+			m_File.write(reinterpret_cast<const char*>(&m_Moves), sizeof(m_Moves));
+		}
+		m_File.close();
+	}
+
+	void GCodeWriter::WriteMove(ar::mat::Vec3 point)
+	{
+		if (m_Options.Dialect == GCodeDialect::Binary)
+		{
+			m_Buffer.append(reinterpret_cast<const char*>(point.Data()), reinterpret_cast<const char*>(point.Data() + 3));
+			m_Moves++;
+		}
+		else
+		{
+			auto coords = ToThousandths(point);
+			bool elide = m_Options.ElideModalAxes && m_HasLast;
+			if (elide && coords == m_Last)
+				return;	// nothing would be left to write
+
+			if (m_Options.Dialect == GCodeDialect::Numbered)
+				fmt::format_to(std::back_inserter(m_Buffer), FMT_COMPILE("N{}"), m_Moves);
+			WriteWord("G01");
+			WriteAxes(coords, elide);
+			m_Buffer.push_back('\n');
+
+			m_Last = coords;
+			m_HasLast = true;
+			m_Moves++;
+		}
+
+		if (m_Buffer.size() >= s_FlushThreshold)
+			Flush();
+	}
+
+	void GCodeWriter::Flush()
+	{
+		m_File.write(m_Buffer.data(), m_Buffer.size());
+		m_Buffer.clear();
+	}
+
+	void GCodeWriter::WriteArc(ar::mat::Vec3 end, ar::mat::Vec3 center, bool clockwise, ArcPlane plane)
+	{
+		AR_ASSERT(m_HasLast && m_Options.Dialect != GCodeDialect::Binary, "Arc written without a starting point");
+		auto coords = ToThousandths(end);
+		auto centerCoords = ToThousandths(center);
+
+		if (m_Options.Dialect == GCodeDialect::Numbered)
+			fmt::format_to(std::back_inserter(m_Buffer), FMT_COMPILE("N{}"), m_Moves);
+		if (plane != m_Plane)
+		{
+			WriteWord(plane == ArcPlane::XY ? "G17" : "G18");
+			m_Plane = plane;
+		}
+		WriteWord(clockwise ? "G02" : "G03");
+		WriteAxes(coords, m_Options.ElideModalAxes);
+
+		// center offsets are relative to the arc start as the controller sees it (after rounding)
+		WriteAxis('I', centerCoords[0] - m_Last[0]);
+		if (plane == ArcPlane::XY)
+			WriteAxis('J', centerCoords[1] - m_Last[1]);
+		else
+			WriteAxis('K', centerCoords[2] - m_Last[2]);
+		m_Buffer.push_back('\n');
+
+		m_Last = coords;
+		m_Moves++;
+		if (m_Buffer.size() >= s_FlushThreshold)
+			Flush();
+	}
+
+	void GCodeWriter::WriteAxes(const std::array<int64_t, 3>& coords, bool elide)
+	{
+		const char axes[] = { 'X', 'Y', 'Z' };
+		for (size_t i = 0; i < 3; ++i)
+			if (!elide || coords[i] != m_Last[i])
+				WriteAxis(axes[i], coords[i]);
+	}
+
+	void GCodeWriter::WriteWord(const char* word)
+	{
+		if (m_Options.Dialect == GCodeDialect::Plain && m_Buffer.size() && m_Buffer[m_Buffer.size() - 1] != '\n')
+			m_Buffer.push_back(' ');
+		m_Buffer.append(word, word + std::strlen(word));
+	}
+
+	void GCodeWriter::WriteAxis(char axis, int64_t value)
+	{
+		if (m_Options.Dialect == GCodeDialect::Plain)
+			m_Buffer.push_back(' ');
+		m_Buffer.push_back(axis);
+		if (value < 0)
+			m_Buffer.push_back('-');
+		auto magnitude = static_cast<uint64_t>(value < 0 ? -value : value);
+		fmt::format_to(std::back_inserter(m_Buffer), FMT_COMPILE("{}.{:03}"), magnitude / 1000, magnitude % 1000);
+	}
+
+	std::array<int64_t, 3> GCodeWriter::ToThousandths(ar::mat::Vec3 point)
+	{
+		return {
+			std::llround(point.x * 1000.0),
+			std::llround(point.y * 1000.0),
+			std::llround(point.z * 1000.0)
+		};
+	}
+
+	std::string GCodeWriter::Extension(ToolType type, GCodeDialect dialect)
+	{
+		// binary programs keep the cutter in the extension so the simulator can still infer it
+		auto extension = ToolTypeStr(type);
+		if (dialect == GCodeDialect::Binary)
+			extension += "b";
+		return extension;
+	}
+
+	bool GCodeWriter::ReadBinary(const std::filesystem::path& filepath, std::vector<ar::mat::Vec3>& points)
+	{
+		std::ifstream file(filepath, std::ios::binary);
+		BinaryHeader header, expected;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != expected.Magic)
+			return false;
+		if (header.Version != expected.Version)
+		{
+			AR_ERROR("Unsupported binary toolpath version {0}", header.Version);
+			return false;
+		}
+
+		// the count is checked against the file before anything is allocated for it
+		std::error_code error;
+		auto remaining = std::filesystem::file_size(filepath, error) - sizeof(header);
+		bool fits = !error && header.Count <= remaining / sizeof(ar::mat::Vec3);
+		if (fits)
+		{
+			points.resize(header.Count);
+			file.read(reinterpret_cast<char*>(points.data()), header.Count * sizeof(ar::mat::Vec3));
+		}
+		if (!fits || !file)
+		{
+			AR_ERROR("Binary toolpath {0} is truncated", filepath.string());
+			points.clear();
+			return false;
+		}
+		return true;
+	}
+}
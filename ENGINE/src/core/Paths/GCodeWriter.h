@@ -0,0 +1,75 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <array>
+#include <fmt/format.h>
+#include "vector_types.h"
+#include "core/Paths/ToolType.h"
+
+namespace ar
+{
+	enum class GCodeDialect
+	{
+		Numbered,	// N<n>G01X<x>Y<y>Z<z> -- what the lab controller and the simulator expect
+		Plain,		// G01 X<x> Y<y> Z<z>, no block numbers
+		Binary		// header followed by raw float triplets, loaded directly by the simulator
+	};
+
+	// Circular interpolation planes; ZX arcs are oriented as seen by G18, i.e. with Z as the first axis
+	enum class ArcPlane
+	{
+		XY,	// G17
+		ZX	// G18
+	};
+
+	struct GCodeWriterOptions
+	{
+		GCodeDialect Dialect = GCodeDialect::Numbered;
+		bool ElideModalAxes = false;	// omit X/Y/Z words that did not change since the previous block
+		float ArcTolerance = 0.0f;		// in millimeters, 0 writes pure G01 polylines
+	};
+
+	// Formats moves straight into a reusable memory buffer and writes it out in large blocks
+	class GCodeWriter
+	{
+	public:
+		using Options = GCodeWriterOptions;
+		struct BinaryHeader
+		{
+			std::array<char, 4> Magic = { 'A', 'R', 'T', 'P' };
+			uint32_t Version = 1;
+			uint64_t Count = 0;
+		};
+
+		GCodeWriter(const std::filesystem::path& filepath, Options options = {});
+		~GCodeWriter();
+		inline bool IsOpen() const { return m_File.is_open(); }
+		inline uint64_t GetMoveCount() const { return m_Moves; }
+
+		// coordinates in millimeters
+		void WriteMove(ar::mat::Vec3 point);
+		// arc from the previous move's end; not available in the binary dialect
+		void WriteArc(ar::mat::Vec3 end, ar::mat::Vec3 center, bool clockwise, ArcPlane plane);
+		void Flush();
+
+		static std::string Extension(ToolType type, GCodeDialect dialect);
+		// returns false if the file is not a binary toolpath
+		static bool ReadBinary(const std::filesystem::path& filepath, std::vector<ar::mat::Vec3>& points);
+
+	private:
+		static constexpr size_t s_FlushThreshold = 1 << 20;
+
+		void WriteAxis(char axis, int64_t value);
+		void WriteAxes(const std::array<int64_t, 3>& coords, bool elide);
+		void WriteWord(const char* word);
+		static std::array<int64_t, 3> ToThousandths(ar::mat::Vec3 point);
+
+		Options m_Options;
+		std::ofstream m_File;
+		fmt::memory_buffer m_Buffer;
+		uint64_t m_Moves = 0;
+		bool m_HasLast = false;
+		std::array<int64_t, 3> m_Last{};	// last written coordinates, in thousandths of a millimeter
+		ArcPlane m_Plane = ArcPlane::XY;
+	};
+}
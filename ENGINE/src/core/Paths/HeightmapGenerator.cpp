@@ -1,6 +1,7 @@
 #include "arpch.h"
 #include "HeightmapGenerator.h"
 #include "core/Utils/Parametric.h"
+#include <execution>
 
 namespace ar
 {
@@ -33,6 +34,96 @@ namespace ar
 		return hm;
 	}
 
+	HeightmapGenerator::ToolOffsetMap HeightmapGenerator::GenerateToolOffset(HeightmapDesc desc, const std::vector<float>& hmap,
+		float toolRadius, bool isFlat, uint32_t maxSamples)
+	{
+		// 1. max-pool the heightmap down to at most maxSamples per side, padded by the tool radius --
+		// both only ever raise the result, so the offset stays conservative. Cells keep the aspect
+		// of the texels, so each axis has its own cell size and padding.
+		uint32_t factorX = (desc.SamplesX + maxSamples - 1) / maxSamples;
+		uint32_t factorY = (desc.SamplesY + maxSamples - 1) / maxSamples;
+		float cellX = desc.RealWidth / desc.SamplesX * factorX;
+		float cellY = desc.RealHeight / desc.SamplesY * factorY;
+		int padX = static_cast<int>(std::ceil(toolRadius / cellX));
+		int padY = static_cast<int>(std::ceil(toolRadius / cellY));
+
+		ToolOffsetMap offset;
+		offset.Desc = desc;
+		offset.Desc.SamplesX = (desc.SamplesX + factorX - 1) / factorX + 2 * padX;
+		offset.Desc.SamplesY = (desc.SamplesY + factorY - 1) / factorY + 2 * padY;
+		offset.Desc.RealWidth = offset.Desc.SamplesX * cellX;
+		offset.Desc.RealHeight = offset.Desc.SamplesY * cellY;
+		offset.Desc.LowerLeftCorner = { desc.LowerLeftCorner.x - padX * cellX, desc.LowerLeftCorner.y + padY * cellY };
+
+		const int width = offset.Desc.SamplesX, height = offset.Desc.SamplesY;
+		std::vector<float> pooled(static_cast<size_t>(width) * height, desc.MinHeight);
+		for (uint32_t y = 0; y < desc.SamplesY; y++)
+			for (uint32_t x = 0; x < desc.SamplesX; x++)
+			{
+				auto& h = pooled[(y / factorY + padY) * width + x / factorX + padX];
+				h = std::max(h, hmap[y * desc.SamplesX + x]);
+			}
+
+		// 2. dilate by the cutter shape, measuring the gap between cells rather than between their centers
+		offset.Heights.resize(pooled.size());
+		std::vector<int> rows(height);
+		std::iota(rows.begin(), rows.end(), 0);
+		std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int cy)
+			{
+				for (int cx = 0; cx < width; cx++)
+				{
+					float result = desc.MinHeight;
+					for (int ny = std::max(cy - padY, 0); ny <= std::min(cy + padY, height - 1); ny++)
+					{
+						float gapY = std::max(std::abs(ny - cy) - 1, 0) * cellY;
+						for (int nx = std::max(cx - padX, 0); nx <= std::min(cx + padX, width - 1); nx++)
+						{
+							float gapX = std::max(std::abs(nx - cx) - 1, 0) * cellX;
+							float gap2 = gapX * gapX + gapY * gapY;
+							if (gap2 >= toolRadius * toolRadius)
+								continue;
+							float h = pooled[ny * width + nx];
+							if (!isFlat)
+								h += std::sqrt(toolRadius * toolRadius - gap2) - toolRadius;
+							result = std::max(result, h);
+						}
+					}
+					offset.Heights[cy * width + cx] = result;
+				}
+			});
+		return offset;
+	}
+
+	float HeightmapGenerator::ToolOffsetMap::Sample(ar::mat::Vec3 point) const
+	{
+		auto mapped = MapPoint(Desc, point);
+		if (mapped.x == -1 || mapped.y == -1)
+			return -std::numeric_limits<float>::infinity();
+		return Heights[mapped.y * Desc.SamplesX + mapped.x];
+	}
+
+	bool HeightmapGenerator::Save(const std::filesystem::path& filepath, HeightmapDesc desc, const std::vector<float>& hmap,
+		float baseHeight)
+	{
+		if (hmap.size() != static_cast<size_t>(desc.SamplesX) * desc.SamplesY)
+			return false;
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file)
+			return false;
+
+		const uint32_t version = 1;
+		float placement[] = { desc.LowerLeftCorner.x, desc.LowerLeftCorner.y, desc.RealWidth, desc.RealHeight };
+		uint32_t samples[] = { desc.SamplesX, desc.SamplesY };
+		float heights[] = { desc.MinHeight, baseHeight };
+		file.write("ARHM", 4);
+		file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		file.write(reinterpret_cast<const char*>(placement), sizeof(placement));
+		file.write(reinterpret_cast<const char*>(samples), sizeof(samples));
+		file.write(reinterpret_cast<const char*>(heights), sizeof(heights));
+		file.write(reinterpret_cast<const char*>(hmap.data()), hmap.size() * sizeof(float));
+		return file.good();
+	}
+
 	ar::mat::Vec2T<int> HeightmapGenerator::MapPoint(HeightmapDesc desc, ar::mat::Vec3d point)
 	{
 		// Project point (x, y, z) to (x', y') on a heightmap (-1 if outside the heightmap)
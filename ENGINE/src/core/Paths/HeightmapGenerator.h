@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <filesystem>
 #include "core/Scene/Entity.h"
 
 namespace ar
@@ -16,7 +17,23 @@ namespace ar
 			float MinHeight = 0.f;
 		};
 
+		// Lowest safe height of the tool tip over each texel, stored with a margin of one tool radius
+		struct ToolOffsetMap
+		{
+			HeightmapDesc Desc;
+			std::vector<float> Heights;
+
+			float Sample(ar::mat::Vec3 point) const;
+		};
+
 		static std::vector<float> Generate(HeightmapDesc desc, std::vector<ar::Entity> objects);
+		static ToolOffsetMap GenerateToolOffset(HeightmapDesc desc, const std::vector<float>& hmap,
+			float toolRadius, bool isFlat, uint32_t maxSamples = 300);
+		// Design heights for the simulator's deviation analysis: a 40-byte header ("ARHM", version 1,
+		// LowerLeftCorner, RealWidth, RealHeight, SamplesX, SamplesY, MinHeight, baseHeight) followed by
+		// the row-major float heights; baseHeight lifts them into machine coordinates like ToolPath
+		static bool Save(const std::filesystem::path& filepath, HeightmapDesc desc, const std::vector<float>& hmap,
+			float baseHeight = 1.5f);
 		static ar::mat::Vec2T<int> MapPoint(HeightmapDesc desc, ar::mat::Vec3d point);
 		static ar::mat::Vec2T<int> MapPoint(HeightmapDesc desc, ar::mat::Vec3 point);
 	};
@@ -2,6 +2,8 @@
 #include "PathGenerator.h"
 #include "core/Scene/Components.h"
 #include <numbers>
+#include <execution>
+#include <limits>
 #include "core/Utils/GeneralUtils.h"
 
 namespace n = std::numbers;
@@ -9,6 +11,7 @@ namespace n = std::numbers;
 namespace ar
 {
 	const float PathGenerator::m_BaseMargin = 0.1f;
+	const float PathGenerator::m_FaceMillToolRadius = 0.8f;
 	ar::ToolPath PathGenerator::GenerateFaceMill(MillingConfig config, std::vector<ar::Entity> objects)
 	{
 		ToolPath path(config.StartPoint, config.Type);
@@ -16,33 +19,18 @@ namespace ar
 		const float upperHeight = 1.85f;
 		const float lowerHeight = 0.3f;
 
-		const ar::mat::Vec3
-			forward = { 0.0f, 0.0f, -1.0f },
-			down = { 0.0f, -1.0f, 0.0f },
-			up = { 0.0f, 1.0f, 0.0f };
+		const ar::mat::Vec3 forward = { 0.0f, 0.0f, -1.0f };
 		const float limit = 8.7916f;
 
 		// 1. move the tool away from the center and down
 		path.MoveTo({ -limit, limit, config.StartPoint.z });
 		path.MoveBy(forward * (config.StartPoint.z - upperHeight));
 
-		// 2. upper path
+		// 2. upper path, each pass is simplified against its own heightmap
 		HeightmapGenerator::HeightmapDesc desc;
 		desc.MinHeight = upperHeight;
 		auto hmap = HeightmapGenerator::Generate(desc, objects);
-
-		ar::mat::Vec3 dirX = { 1.0f, 0.0f, 0.0f }, dirY = { 0.0f, -1.0f, 0.0f };
-		bool rightMovement = true;
-		while (path.GetCurrentPos().y > -limit)
-		{
-			if (rightMovement)
-				AddFaceMillHorizontalPathRight(path, config, hmap, desc);
-			else
-				AddFaceMillHorizontalPathLeft(path, config, hmap, desc);
-			path.MoveBy(down * config.StepY);
-			rightMovement = !rightMovement;
-		}
-		AddFaceMillHorizontalPathRight(path, config, hmap, desc);
+		AddFaceMillRows(path, config, hmap, desc, true, true);
 
 		// 2.5 Move down to lower height
 		path.MoveBy(forward * (upperHeight - lowerHeight));
@@ -50,17 +38,7 @@ namespace ar
 		// 3. lower path
 		desc.MinHeight = lowerHeight;
 		hmap = HeightmapGenerator::Generate(desc, objects);
-		rightMovement = false;
-		while (path.GetCurrentPos().y < limit)
-		{
-			if (rightMovement)
-				AddFaceMillHorizontalPathRight(path, config, hmap, desc);
-			else
-				AddFaceMillHorizontalPathLeft(path, config, hmap, desc);
-			path.MoveBy(up * config.StepY);
-			rightMovement = !rightMovement;
-		}
-		AddFaceMillHorizontalPathLeft(path, config, hmap, desc);
+		AddFaceMillRows(path, config, hmap, desc, false, false);
 
 		// 4. return the tool to original position
 		path.MoveTo({ -limit, limit, config.StartPoint.z });
@@ -82,14 +60,16 @@ namespace ar
 		HeightmapGenerator::HeightmapDesc desc;
 		desc.MinHeight = 0.0f;
 		auto hmap = HeightmapGenerator::Generate(desc, objects);
+		auto grid = ProbeCollisions(config, hmap, desc, { -limit, 7.5f }, limit, 0.5f);
+		int row = 0, col = 0;
 
 		// 3. mill left half of the base
 		bool rightMovement = true;
-		while (path.GetCurrentPos().y > -7.5f)
+		while (grid.Node(row, col, m_BaseMargin).y > -7.5f)
 		{
 			if (rightMovement)
 			{
-				if (!AddBaseMillPathRight(path, config, hmap, desc, 3.5f))
+				if (!AddBaseMillPathRight(path, grid, row, col, 3.5f))
 				{
 					// early return
 				}
@@ -97,7 +77,7 @@ namespace ar
 			}
 			else
 			{
-				if (!AddBaseMillPathLeft(path, config, hmap, desc, -limit))
+				if (!AddBaseMillPathLeft(path, grid, row, col, -limit))
 				{
 					// early return, cannot go left
 					AR_ERROR("PATHS STUCK!");
@@ -105,23 +85,27 @@ namespace ar
 				rightMovement = !rightMovement;
 			}
 			
-			if (!AddBaseMillPathVertical(path, config, hmap, desc, false))
+			if (!AddBaseMillPathVertical(path, grid, row, col, false))
 			{
 				// cannot go down
 			}
 			
 		}
-		// 4. go to the right half
-		path.MoveBy({ 2 * 8.2f, 0.0f, 0.0f });
-		AddBaseMillPathVertical(path, config, hmap, desc, true);
+		// 4. go to the right half -- the same move by twice the limit as always, so the right half gets a grid
+		// of its own, with a node where the move ends and columns left of where its rows stop
+		auto rightStart = grid.Node(row, col, m_BaseMargin) + ar::mat::Vec3{ 2 * limit, 0.0f, 0.0f };
+		col = static_cast<int>(std::ceil((rightStart.x + 3.5f) / config.StepX));
+		grid = ProbeCollisions(config, hmap, desc, { rightStart.x - col * config.StepX, 7.5f }, limit, 0.5f);
+		path.MoveTo(grid.Node(row, col, m_BaseMargin));
+		AddBaseMillPathVertical(path, grid, row, col, true);
 
 		// 5. mill right half of the base
 		rightMovement = false;
-		while (path.GetCurrentPos().y < 7.5f)
+		while (grid.Node(row, col, m_BaseMargin).y < 7.5f)
 		{
 			if (!rightMovement)
 			{
-				if (!AddBaseMillPathLeft(path, config, hmap, desc, -3.5f))
+				if (!AddBaseMillPathLeft(path, grid, row, col, -3.5f))
 				{
 					// early return
 				}
@@ -129,7 +113,7 @@ namespace ar
 			}
 			else
 			{
-				if (!AddBaseMillPathRight(path, config, hmap, desc, limit))
+				if (!AddBaseMillPathRight(path, grid, row, col, limit))
 				{
 					// early return, cannot go right
 					AR_ERROR("PATHS STUCK!");
@@ -137,7 +121,7 @@ namespace ar
 				rightMovement = !rightMovement;
 			}
 
-			if (!AddBaseMillPathVertical(path, config, hmap, desc, true))
+			if (!AddBaseMillPathVertical(path, grid, row, col, true))
 			{
 				// cannot go up
 			}
@@ -147,6 +131,16 @@ namespace ar
 		path.MoveTo({ -limit, 7.5f, m_BaseMargin });
 		path.MoveBy(ar::mat::Vec3{ 0.0f, 0.0f, 1.0f } * config.StartPoint.z);
 		path.MoveTo(config.StartPoint);
+
+		// 7. drop nearly collinear moves wherever that cannot gouge the part
+		if (config.SimplifyTolerance > 0.0f)
+		{
+			auto offset = HeightmapGenerator::GenerateToolOffset(desc, hmap,
+				ToolTypeRadius(config.Type), ToolTypeIsFlat(config.Type));
+			auto stats = path.Simplify(config.SimplifyTolerance, offset);
+			AR_INFO("Base mill path simplified from {0} to {1} points ({2:.1f}% removed)",
+				stats.PointsBefore, stats.PointsAfter, 100.0f * stats.ReductionRatio());
+		}
 		return path;
 	}
 
@@ -222,158 +216,271 @@ namespace ar
 		return false;
 	}
 
-	void PathGenerator::AddFaceMillHorizontalPathRight(ToolPath& path, MillingConfig config,
-		const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc)
+	void PathGenerator::AddFaceMillRows(ToolPath& path, MillingConfig config,
+		const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, bool goesDown, bool startsRight)
 	{
-		float toolRadius = 0.8f;
 		const float limit = 8.7916f;
+		const ar::mat::Vec3 rowStep = ar::mat::Vec3{ 0.0f, goesDown ? -1.0f : 1.0f, 0.0f } * config.StepY;
+
+		// 1. plan the rows -- where a row starts depends only on the steps, and its height on where
+		// the previous row ends, which is always a lattice point resting on the heightmap
+		std::vector<ToolPath> rows;
+		std::vector<uint8_t> rowsRight;
+		auto rowStart = path.GetCurrentPos() - ar::mat::Vec3{ 0.0f, 0.0f, path.GetBaseHeight() };
+		auto planRow = [&](bool right)
+			{
+				rows.emplace_back(rowStart, config.Type, path.GetBaseHeight());
+				rowsRight.push_back(right);
+				auto startX = rowStart.x;
+				if (right)
+					while (rowStart.x < limit) rowStart.x += config.StepX;
+				else
+					while (rowStart.x > -limit) rowStart.x -= config.StepX;
+				if (rowStart.x != startX)
+					rowStart.z = SampleFaceMillHeight(hmap, desc, { rowStart.x, rowStart.y, 0.0f }, m_FaceMillToolRadius);
+			};
+		bool rightMovement = startsRight;
+		while (goesDown ? rowStart.y > -limit : rowStart.y < limit)
+		{
+			planRow(rightMovement);
+			rowStart = rowStart + rowStep;
+			rightMovement = !rightMovement;
+		}
+		planRow(startsRight);
+
+		// 2. rows only read the heightmap, so they are generated concurrently
+		auto flat = BuildFlatnessTable(hmap, desc);
+		std::vector<size_t> indices(rows.size());
+		std::iota(indices.begin(), indices.end(), 0);
+		std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i)
+			{
+				AddFaceMillHorizontalPath(rows[i], config, hmap, desc, flat, rowsRight[i]);
+			});
 
-		while (path.GetCurrentPos().x < limit)
+		// 3. stitch the rows in order
+		ToolPath pass(path.GetCurrentPos() - ar::mat::Vec3{ 0.0f, 0.0f, path.GetBaseHeight() }, config.Type, path.GetBaseHeight());
+		for (size_t i = 0; i < rows.size(); ++i)
 		{
-			ar::mat::Vec3 nextPos = path.GetCurrentPos() + ar::mat::Vec3{1.0f, 0.0f, 0.0f} * config.StepX;
-			
-			// find position of the tool center
-			ar::mat::Vec3d center = { nextPos.x, nextPos.y, 0.0f };
-			auto mapped = HeightmapGenerator::MapPoint(desc, nextPos);
-			if (mapped.x == -1 || mapped.y == -1) // center outside of the milling material
-				center.z = desc.MinHeight + toolRadius;
-			else
+			pass.Append(rows[i]);
+			if (i + 1 < rows.size())
+				pass.MoveBy(rowStep);
+		}
+
+		// 4. drop nearly collinear moves wherever that cannot gouge the part or cut below this pass
+		if (config.SimplifyTolerance > 0.0f)
+		{
+			auto offset = HeightmapGenerator::GenerateToolOffset(desc, hmap,
+				ToolTypeRadius(config.Type), ToolTypeIsFlat(config.Type));
+			auto stats = pass.Simplify(config.SimplifyTolerance, offset);
+			AR_INFO("Face mill pass at {0} simplified from {1} to {2} points ({3:.1f}% removed)",
+				desc.MinHeight, stats.PointsBefore, stats.PointsAfter, 100.0f * stats.ReductionRatio());
+		}
+		path.Append(pass);
+	}
+
+	PathGenerator::FlatnessTable PathGenerator::BuildFlatnessTable(const std::vector<float>& hmap,
+		HeightmapGenerator::HeightmapDesc desc)
+	{
+		// summed-area table of texels raised above the heightmap's base level
+		FlatnessTable table;
+		table.Width = desc.SamplesX + 1;
+		table.Raised.assign(static_cast<size_t>(desc.SamplesX + 1) * (desc.SamplesY + 1), 0);
+		for (uint32_t row = 0; row < desc.SamplesY; row++)
+		{
+			uint32_t rowSum = 0;
+			for (uint32_t col = 0; col < desc.SamplesX; col++)
 			{
-				auto hmHeight = hmap[mapped.y * desc.SamplesX + mapped.x];
-				center.z = hmHeight + toolRadius;
+				rowSum += hmap[row * desc.SamplesX + col] > desc.MinHeight ? 1 : 0;
+				table.Raised[(row + 1) * table.Width + col + 1] = table.Raised[row * table.Width + col + 1] + rowSum;
 			}
-			nextPos.z = center.z - toolRadius;
-
-			// moving the tool up if gouging
-			float maxHeight = nextPos.z;
-			const int samples = 10;
-			const float stepV = 2 * n::pi / samples;
-			const float stepU = n::pi / 2 / samples;
-			for (int ii = 0; ii < samples; ii++)
+		}
+		return table;
+	}
+
+	bool PathGenerator::FlatnessTable::IsFlat(HeightmapGenerator::HeightmapDesc desc, float fromX, float toX, float y, float toolRadius) const
+	{
+		// texel rectangle under the tool swept from fromX to toX; parts outside the heightmap count as flat
+		auto cellWidth = desc.RealWidth / desc.SamplesX;
+		auto cellHeight = desc.RealHeight / desc.SamplesY;
+		int colMin = static_cast<int>(std::floor((std::min(fromX, toX) - toolRadius - desc.LowerLeftCorner.x) / cellWidth));
+		int colMax = static_cast<int>(std::floor((std::max(fromX, toX) + toolRadius - desc.LowerLeftCorner.x) / cellWidth));
+		int rowMin = static_cast<int>(std::floor((desc.LowerLeftCorner.y - (y + toolRadius)) / cellHeight));
+		int rowMax = static_cast<int>(std::floor((desc.LowerLeftCorner.y - (y - toolRadius)) / cellHeight));
+		colMin = std::max(colMin, 0);
+		rowMin = std::max(rowMin, 0);
+		colMax = std::min(colMax, static_cast<int>(desc.SamplesX) - 1);
+		rowMax = std::min(rowMax, static_cast<int>(desc.SamplesY) - 1);
+		if (colMin > colMax || rowMin > rowMax)
+			return true;
+
+		auto at = [&](int row, int col) { return Raised[static_cast<size_t>(row) * Width + col]; };
+		auto raised = at(rowMax + 1, colMax + 1) - at(rowMin, colMax + 1) - at(rowMax + 1, colMin) + at(rowMin, colMin);
+		return raised == 0;
+	}
+
+	float PathGenerator::SampleFaceMillHeight(const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc,
+		ar::mat::Vec3 pos, float toolRadius)
+	{
+		// height of the tool tip resting on the heightmap
+		float maxHeight = desc.MinHeight;
+		auto mapped = HeightmapGenerator::MapPoint(desc, pos);
+		if (mapped.x != -1 && mapped.y != -1) // center inside of the milling material
+			maxHeight = hmap[mapped.y * desc.SamplesX + mapped.x];
+
+		// moving the tool up if gouging
+		const int samples = 10;
+		const float stepV = 2 * n::pi / samples;
+		const float stepU = n::pi / 2 / samples;
+		for (int ii = 0; ii < samples; ii++)
+		{
+			for (int jj = 0; jj < samples; jj++)
 			{
-				for (int jj = 0; jj < samples; jj++)
+				float u = (n::pi / 2) + ii * stepU;
+				float v = jj * stepV;
+				ar::mat::Vec3d point = ar::mat::Vec3d{ pos.x, pos.y, 0.0f } + ar::mat::Vec3d{ sin(u) * cos(v) * toolRadius, sin(u) * sin(v) * toolRadius, 0.0f };
+				mapped = HeightmapGenerator::MapPoint(desc, point);
+				if (mapped.x != -1 && mapped.y != -1)
 				{
-					float u = (n::pi / 2) + ii * stepU;
-					float v = jj * stepV;
-					ar::mat::Vec3d point = center + ar::mat::Vec3d{ sin(u) * cos(v) * toolRadius, sin(u) * sin(v) * toolRadius, cos(u) * toolRadius };
-					mapped = HeightmapGenerator::MapPoint(desc, point);
-					if (mapped.x != -1 && mapped.y != -1)
-					{
-						auto height = hmap[mapped.y * desc.SamplesX + mapped.x];
-						if (height > maxHeight)
-							maxHeight = height;
-					}
+					auto height = hmap[mapped.y * desc.SamplesX + mapped.x];
+					if (height > maxHeight)
+						maxHeight = height;
 				}
 			}
-			nextPos.z = maxHeight;
-			path.MoveTo(nextPos);
 		}
+		return maxHeight;
 	}
 
-	void PathGenerator::AddFaceMillHorizontalPathLeft(ToolPath& path, MillingConfig config,
-		const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc)
+	void PathGenerator::AddFaceMillHorizontalPath(ToolPath& path, MillingConfig config, const std::vector<float>& hmap,
+		HeightmapGenerator::HeightmapDesc desc, const FlatnessTable& flat, bool goesRight)
 	{
-		float toolRadius = 0.8f;
+		const float toolRadius = m_FaceMillToolRadius;
 		const float limit = 8.7916f;
-
-		while (path.GetCurrentPos().x > -limit)
+		const float y = path.GetCurrentPos().y;
+
+		// the pass ends on the same StepX lattice as a fixed-step pass would
+		std::vector<float> xs{ path.GetCurrentPos().x };
+		while (goesRight ? xs.back() < limit : xs.back() > -limit)
+			xs.push_back(goesRight ? xs.back() + config.StepX : xs.back() - config.StepX);
+
+		// heights are sampled lazily -- lattice points over flat stock are never evaluated
+		// the row starts where the previous one was planned to end, so this is the stitched height
+		std::vector<float> heights(xs.size(), std::numeric_limits<float>::quiet_NaN());
+		heights[0] = path.GetCurrentPos().z - path.GetBaseHeight();
+		auto heightAt = [&](size_t k)
+			{
+				if (std::isnan(heights[k]))
+					heights[k] = SampleFaceMillHeight(hmap, desc, { xs[k], y, 0.0f }, toolRadius);
+				return heights[k];
+			};
+
+		size_t anchor = 0;
+		const size_t last = xs.size() - 1;
+		while (anchor < last)
 		{
-			ar::mat::Vec3 nextPos = path.GetCurrentPos() + ar::mat::Vec3{ -1.0f, 0.0f, 0.0f } *config.StepX;
-
-			// find position of the tool center
-			ar::mat::Vec3d center = { nextPos.x, nextPos.y, 0.0f };
-			auto mapped = HeightmapGenerator::MapPoint(desc, nextPos);
-			if (mapped.x == -1 || mapped.y == -1) // center outside of the milling material
-				center.z = desc.MinHeight + toolRadius;
-			else
+			// 1. flat stock ahead -- jump to the furthest lattice point the tool can reach without touching the part
+			if (heights[anchor] <= desc.MinHeight)
 			{
-				auto hmHeight = hmap[mapped.y * desc.SamplesX + mapped.x];
-				center.z = hmHeight + toolRadius;
+				size_t step = 1;
+				while (anchor + 2 * step <= last && flat.IsFlat(desc, xs[anchor], xs[anchor + 2 * step], y, toolRadius))
+					step *= 2;
+				size_t reach = anchor;
+				for (; step > 0; step /= 2)
+					if (reach + step <= last && flat.IsFlat(desc, xs[anchor], xs[reach + step], y, toolRadius))
+						reach += step;
+				if (reach > anchor + 1)
+				{
+					heights[reach] = desc.MinHeight;
+					path.MoveTo({ xs[reach], y, desc.MinHeight });
+					anchor = reach;
+					continue;
+				}
 			}
-			nextPos.z = center.z - toolRadius;
-
-			// moving the tool up if gouging
-			float maxHeight = nextPos.z;
-			const int samples = 10;
-			const float stepV = 2 * n::pi / samples;
-			const float stepU = n::pi / 2 / samples;
-			for (int ii = 0; ii < samples; ii++)
+
+			// 2. extend the chord while it never dips below the samples nor leaves more than the tolerance above them
+			size_t end = anchor + 1;
+			heightAt(end);
+			while (end < last)
 			{
-				for (int jj = 0; jj < samples; jj++)
+				size_t candidate = end + 1;
+				float slope = (heightAt(candidate) - heights[anchor]) / (xs[candidate] - xs[anchor]);
+				bool withinTolerance = true;
+				for (size_t i = anchor + 1; i < candidate && withinTolerance; i++)
 				{
-					float u = (n::pi / 2) + ii * stepU;
-					float v = jj * stepV;
-					ar::mat::Vec3d point = center + ar::mat::Vec3d{ sin(u) * cos(v) * toolRadius, sin(u) * sin(v) * toolRadius, cos(u) * toolRadius };
-					mapped = HeightmapGenerator::MapPoint(desc, point);
-					if (mapped.x != -1 && mapped.y != -1)
-					{
-						auto height = hmap[mapped.y * desc.SamplesX + mapped.x];
-						if (height > maxHeight)
-							maxHeight = height;
-					}
+					float chord = heights[anchor] + slope * (xs[i] - xs[anchor]);
+					withinTolerance = chord >= heights[i] && chord - heights[i] <= config.ChordTolerance;
 				}
+				if (!withinTolerance)
+					break;
+				end = candidate;
 			}
-			nextPos.z = maxHeight;
-			path.MoveTo(nextPos);
+			path.MoveTo({ xs[end], y, heights[end] });
+			anchor = end;
 		}
 	}
 
-	bool PathGenerator::AddBaseMillPathRight(ToolPath& path, MillingConfig config, const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, float stopX)
+	PathGenerator::ProbeGrid PathGenerator::ProbeCollisions(MillingConfig config, const std::vector<float>& hmap,
+		HeightmapGenerator::HeightmapDesc desc, ar::mat::Vec2 origin, float limit, float toolRadius)
 	{
-		float toolRadius = 0.5f;
+		ProbeGrid grid;
+		grid.Origin = origin;
+		grid.StepX = config.StepX;
+		grid.StepY = config.StepY;
+		grid.Columns = 1;
+		while (origin.x + (grid.Columns - 1) * grid.StepX < limit)
+			grid.Columns++;
+		grid.Rows = 1;
+		while (origin.y - (grid.Rows - 1) * grid.StepY > -origin.y)
+			grid.Rows++;
+		grid.Blocked.resize(static_cast<size_t>(grid.Rows) * grid.Columns);
+
+		// every node is probed independently, rows are spread over the available cores
+		std::vector<int> rows(grid.Rows);
+		std::iota(rows.begin(), rows.end(), 0);
+		std::for_each(std::execution::par, rows.begin(), rows.end(), [&](int row)
+			{
+				for (int col = 0; col < grid.Columns; col++)
+					grid.Blocked[static_cast<size_t>(row) * grid.Columns + col] =
+						CheckCollision(hmap, desc, grid.Node(row, col, 0.0f), toolRadius);
+			});
+		return grid;
+	}
 
-		while (path.GetCurrentPos().x < stopX)
+	bool PathGenerator::AddBaseMillPathRight(ToolPath& path, const ProbeGrid& grid, int row, int& col, float stopX)
+	{
+		while (grid.Node(row, col, m_BaseMargin).x < stopX)
 		{
-			ar::mat::Vec3 nextPos = path.GetCurrentPos() + ar::mat::Vec3{ 1.0f, 0.0f, 0.0f } * config.StepX;
-			
 			// if the function didn't return early, it's safe to move
-			if (!CheckCollision(hmap, desc, nextPos, 0.5f))
-			{
-				nextPos.z = 0.0f + m_BaseMargin;
-				path.MoveTo(nextPos);
-			}
-			else
+			if (col + 1 >= grid.Columns || grid.IsBlocked(row, col + 1))
 				return false;
+			col++;
+			path.MoveTo(grid.Node(row, col, m_BaseMargin));
 		}
 		return true;
 	}
 
-	bool PathGenerator::AddBaseMillPathLeft(ToolPath& path, MillingConfig config, const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, float stopX)
+	bool PathGenerator::AddBaseMillPathLeft(ToolPath& path, const ProbeGrid& grid, int row, int& col, float stopX)
 	{
-		float toolRadius = 0.5f;
-
-		while (path.GetCurrentPos().x > stopX)
+		while (grid.Node(row, col, m_BaseMargin).x > stopX)
 		{
-			ar::mat::Vec3 nextPos = path.GetCurrentPos() + ar::mat::Vec3{ -1.0f, 0.0f, 0.0f } * config.StepX;
-			
 			// if the function didn't return early, it's safe to move
-			if (!CheckCollision(hmap, desc, nextPos, 0.5f))
-			{
-				nextPos.z = 0.0f + m_BaseMargin;
-				path.MoveTo(nextPos);
-			}
-			else
+			if (col - 1 < 0 || grid.IsBlocked(row, col - 1))
 				return false;
+			col--;
+			path.MoveTo(grid.Node(row, col, m_BaseMargin));
 		}
 		return true;
 	}
 
-	bool PathGenerator::AddBaseMillPathVertical(ToolPath& path, MillingConfig config, const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, bool goesUp)
+	bool PathGenerator::AddBaseMillPathVertical(ToolPath& path, const ProbeGrid& grid, int& row, int col, bool goesUp)
 	{
-		float toolRadius = 0.5f;
-		ar::mat::Vec3 moveDir = (goesUp) ? 
-			ar::mat::Vec3{0.0f, 1.0f, 0.0f} : ar::mat::Vec3{0.0f, -1.0f, 0.0f};
-		
 		// next planned move
-		ar::mat::Vec3 nextPos = path.GetCurrentPos() + moveDir * config.StepY;
+		int nextRow = goesUp ? row - 1 : row + 1;
 		
 		// if the function didn't return early, it's safe to move
-		if (!CheckCollision(hmap, desc, nextPos, 0.5f))
-		{
-			nextPos.z = 0.0f + m_BaseMargin;
-			path.MoveTo(nextPos);
-			return true;
-		}
-		return false;
+		if (nextRow < 0 || nextRow >= grid.Rows || grid.IsBlocked(nextRow, col))
+			return false;
+		row = nextRow;
+		path.MoveTo(grid.Node(row, col, m_BaseMargin));
+		return true;
 	}
 }
\ No newline at end of file
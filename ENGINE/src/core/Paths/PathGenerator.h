@@ -19,6 +19,8 @@ namespace ar
 			ar::mat::Vec3 StartPoint = {0.0f, 0.0f, 5.1f};
 			float StepY = 1.0f;
 			float StepX = 0.117f;
+			float ChordTolerance = 0.01f;	// max material left above the samples between two moves
+			float SimplifyTolerance = 0.005f;	// max deviation of the simplified path, 0 disables simplification
 			ToolType Type = ToolType::K16;
 		};
 		static ToolPath GenerateFaceMill(MillingConfig config, std::vector<ar::Entity> objects);
@@ -26,19 +28,46 @@ namespace ar
 		static ToolPath GenerateOutlineMill(MillingConfig config, ar::Entity outline, ar::Entity startPoint, ar::mat::Vec3 offsetDir);
 
 	private:
+		// Nodes visited by the base mill, with tool collisions probed up front
+		struct ProbeGrid
+		{
+			ar::mat::Vec2 Origin;
+			float StepX, StepY;
+			int Columns, Rows;
+			std::vector<uint8_t> Blocked;
+
+			inline ar::mat::Vec3 Node(int row, int col, float z) const
+			{
+				return { Origin.x + col * StepX, Origin.y - row * StepY, z };
+			}
+			inline bool IsBlocked(int row, int col) const { return Blocked[static_cast<size_t>(row) * Columns + col]; }
+		};
+
+		// Answers whether a tool sweep only passes over texels at the heightmap's base level
+		struct FlatnessTable
+		{
+			std::vector<uint32_t> Raised;
+			uint32_t Width = 0;
+
+			bool IsFlat(HeightmapGenerator::HeightmapDesc desc, float fromX, float toX, float y, float toolRadius) const;
+		};
+
 		static const float m_BaseMargin;
+		static const float m_FaceMillToolRadius;
 		static bool CheckCollision(const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, ar::mat::Vec3 center, float toolRadius);
 
+		static ProbeGrid ProbeCollisions(MillingConfig config, const std::vector<float>& hmap,
+			HeightmapGenerator::HeightmapDesc desc, ar::mat::Vec2 origin, float limit, float toolRadius);
 
-		static void AddFaceMillHorizontalPathRight(ToolPath& path, MillingConfig config,
-			const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc);
-		static void AddFaceMillHorizontalPathLeft(ToolPath& path, MillingConfig config,
-			const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc);
-		static bool AddBaseMillPathRight(ToolPath& path, MillingConfig config,
-			const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, float stopX);
-		static bool AddBaseMillPathLeft(ToolPath& path, MillingConfig config,
-			const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, float stopX);
-		static bool AddBaseMillPathVertical(ToolPath& path, MillingConfig config,
-			const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, bool goesUp);
+		static void AddFaceMillRows(ToolPath& path, MillingConfig config,
+			const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc, bool goesDown, bool startsRight);
+		static FlatnessTable BuildFlatnessTable(const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc);
+		static float SampleFaceMillHeight(const std::vector<float>& hmap, HeightmapGenerator::HeightmapDesc desc,
+			ar::mat::Vec3 pos, float toolRadius);
+		static void AddFaceMillHorizontalPath(ToolPath& path, MillingConfig config, const std::vector<float>& hmap,
+			HeightmapGenerator::HeightmapDesc desc, const FlatnessTable& flat, bool goesRight);
+		static bool AddBaseMillPathRight(ToolPath& path, const ProbeGrid& grid, int row, int& col, float stopX);
+		static bool AddBaseMillPathLeft(ToolPath& path, const ProbeGrid& grid, int row, int& col, float stopX);
+		static bool AddBaseMillPathVertical(ToolPath& path, const ProbeGrid& grid, int& row, int col, bool goesUp);
 	};
 }
\ No newline at end of file
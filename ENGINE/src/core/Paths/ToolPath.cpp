@@ -1,8 +1,9 @@
 #include "arpch.h"
 #include "ToolPath.h"
 #include "fmt/core.h"
-#include <fstream>
 #include <iostream>
+#include <execution>
+#include <numbers>
 
 namespace ar
 {
@@ -14,7 +15,11 @@ namespace ar
 
 	void ToolPath::MoveTo(ar::mat::Vec3 point)
 	{
-		auto newPoint = point + m_BaseDisplacement;
+		AddMachinePoint(point + m_BaseDisplacement);
+	}
+
+	void ToolPath::AddMachinePoint(ar::mat::Vec3 newPoint)
+	{
 		if (m_MachineCoords.size() > 2)
 		{
 			const auto& preLastPoint = m_MachineCoords.end()[-2];
@@ -37,19 +42,233 @@ namespace ar
 		m_Length += ar::mat::Length(v);
 	}
 
-	void ToolPath::ConvertToGCode(uint32_t order, std::filesystem::path path)
+	void ToolPath::Append(const ToolPath& segment)
+	{
+		// both paths share the base displacement, so machine coordinates can be copied directly
+		for (size_t i = 1; i < segment.m_MachineCoords.size(); ++i)
+			AddMachinePoint(segment.m_MachineCoords[i]);
+	}
+
+	ToolPath::SimplifyStats ToolPath::Simplify(float tolerance, const HeightmapGenerator::ToolOffsetMap& offset)
+	{
+		SimplifyStats stats;
+		stats.PointsBefore = m_MachineCoords.size();
+		if (m_MachineCoords.size() < 3)
+		{
+			stats.PointsAfter = stats.PointsBefore;
+			return stats;
+		}
+
+		// chunk borders are always kept, which lets every chunk be simplified on its own
+		const size_t chunkSize = 1024;
+		std::vector<uint8_t> keep(m_MachineCoords.size(), 0);
+		std::vector<size_t> chunks;
+		for (size_t first = 0; first < m_MachineCoords.size() - 1; first += chunkSize)
+		{
+			chunks.push_back(first);
+			keep[first] = 1;
+		}
+		keep.back() = 1;
+		std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](size_t first)
+			{
+				size_t last = std::min(first + chunkSize, m_MachineCoords.size() - 1);
+				SimplifyRange(first, last, tolerance, offset, keep);
+			});
+
+		std::vector<ar::mat::Vec3> simplified;
+		simplified.reserve(m_MachineCoords.size());
+		m_Length = 0.f;
+		for (size_t i = 0; i < m_MachineCoords.size(); ++i)
+		{
+			if (!keep[i])
+				continue;
+			if (!simplified.empty())
+				m_Length += ar::mat::Length(m_MachineCoords[i] - simplified.back());
+			simplified.push_back(m_MachineCoords[i]);
+		}
+		m_MachineCoords = std::move(simplified);
+
+		stats.PointsAfter = m_MachineCoords.size();
+		return stats;
+	}
+
+	void ToolPath::SimplifyRange(size_t first, size_t last, float tolerance,
+		const HeightmapGenerator::ToolOffsetMap& offset, std::vector<uint8_t>& keep) const
+	{
+		std::vector<std::pair<size_t, size_t>> ranges{ { first, last } };
+		while (!ranges.empty())
+		{
+			auto [start, end] = ranges.back();
+			ranges.pop_back();
+			if (end - start < 2)
+				continue;
+
+			// farthest point from the chord
+			const auto& a = m_MachineCoords[start];
+			const auto chord = m_MachineCoords[end] - a;
+			const float chordLen2 = ar::mat::LengthSquared(chord);
+			float maxDistance = -1.0f;
+			size_t split = start + 1;
+			for (size_t i = start + 1; i < end; ++i)
+			{
+				float t = chordLen2 > 0.0f ? std::clamp(ar::mat::Dot(m_MachineCoords[i] - a, chord) / chordLen2, 0.0f, 1.0f) : 0.0f;
+				float distance = ar::mat::Length(m_MachineCoords[i] - (a + chord * t));
+				if (distance > maxDistance)
+				{
+					maxDistance = distance;
+					split = i;
+				}
+			}
+
+			if (maxDistance <= tolerance && IsSegmentSafe(a, m_MachineCoords[end], offset))
+				continue;
+			keep[split] = 1;
+			ranges.push_back({ start, split });
+			ranges.push_back({ split, end });
+		}
+	}
+
+	bool ToolPath::IsSegmentSafe(ar::mat::Vec3 start, ar::mat::Vec3 end, const HeightmapGenerator::ToolOffsetMap& offset) const
 	{
-		auto filename = fmt::format("{}.{}", order, ar::ToolTypeStr(m_ToolType));
+		const float eps = 1e-4f;
+		const float step = 0.5f * std::min(offset.Desc.RealWidth / offset.Desc.SamplesX,
+			offset.Desc.RealHeight / offset.Desc.SamplesY);
+		auto segment = end - start;
+		auto samples = static_cast<int>(std::ceil(std::hypot(segment.x, segment.y) / step)) + 1;
+		for (int i = 0; i <= samples; i++)
+		{
+			auto point = start + segment * (static_cast<float>(i) / samples) - m_BaseDisplacement;
+			if (point.z < offset.Sample(point) - eps)
+				return false;
+		}
+		return true;
+	}
+
+	void ToolPath::ConvertToGCode(uint32_t order, std::filesystem::path path, GCodeWriter::Options options)
+	{
+		auto filename = fmt::format("{}.{}", order, GCodeWriter::Extension(m_ToolType, options.Dialect));
 		
-		std::ofstream file;
-		file.open(path / filename);
-		if (file.is_open())
+		GCodeWriter writer(path / filename, options);
+		if (!writer.IsOpen())
+		{
+			AR_ERROR("Could not open {0} for writing", (path / filename).string());
+			return;
+		}
+		if (options.ArcTolerance <= 0.0f || options.Dialect == GCodeDialect::Binary)
 		{
-			int step = 0;
 			for (auto& coord : m_MachineCoords)
-				file << fmt::format("N{}G01X{:.3f}Y{:.3f}Z{:.3f}\n", step++, coord.x * 10, coord.y * 10, coord.z * 10);
+				writer.WriteMove(coord * 10);
+			return;
+		}
+
+		auto moves = FitArcs(options.ArcTolerance / 10);
+		writer.WriteMove(m_MachineCoords.front() * 10);
+		for (auto& move : moves)
+		{
+			if (move.Type == MoveType::Linear)
+				writer.WriteMove(move.End * 10);
+			else
+				writer.WriteArc(move.End * 10, move.Center * 10, move.Type == MoveType::ArcCW, move.Plane);
+		}
+		AR_INFO("Arc fitting wrote {0} blocks for {1} points", moves.size() + 1, m_MachineCoords.size());
+	}
+
+	std::vector<ToolPath::Move> ToolPath::FitArcs(float tolerance) const
+	{
+		std::vector<Move> moves;
+		moves.reserve(m_MachineCoords.size());
+		size_t i = 0;
+		while (i + 1 < m_MachineCoords.size())
+		{
+			Move arc, best;
+			size_t bestEnd = i;
+			for (auto plane : { ArcPlane::XY, ArcPlane::ZX })
+			{
+				size_t end = FitArc(i, tolerance, plane, arc);
+				if (end > bestEnd)
+				{
+					bestEnd = end;
+					best = arc;
+				}
+			}
+
+			if (bestEnd > i)
+			{
+				moves.push_back(best);
+				i = bestEnd;
+			}
+			else
+			{
+				moves.push_back(Move{ MoveType::Linear, m_MachineCoords[i + 1] });
+				i++;
+			}
+		}
+		return moves;
+	}
+
+	size_t ToolPath::FitArc(size_t first, float tolerance, ArcPlane plane, Move& move) const
+	{
+		// (u, v) follow the G17/G18 axis order so that a positive turn is a G03
+		auto project = [plane](const ar::mat::Vec3& p) {
+			return plane == ArcPlane::XY ? ar::mat::Vec2d{ p.x, p.y } : ar::mat::Vec2d{ p.z, p.x };
+		};
+		auto fixed = [plane](const ar::mat::Vec3& p) { return plane == ArcPlane::XY ? p.z : p.y; };
+		auto cross = [](ar::mat::Vec2d a, ar::mat::Vec2d b) { return a.x * b.y - a.y * b.x; };
+		auto dot = [](ar::mat::Vec2d a, ar::mat::Vec2d b) { return a.x * b.x + a.y * b.y; };
+		auto length = [dot](ar::mat::Vec2d a) { return std::sqrt(dot(a, a)); };
+
+		constexpr float planeEpsilon = 1e-5f;
+		float level = fixed(m_MachineCoords[first]);
+		size_t limit = std::min(m_MachineCoords.size(), first + s_MaxArcPoints);
+		size_t last = first;
+		while (last + 1 < limit && std::abs(fixed(m_MachineCoords[last + 1]) - level) <= planeEpsilon)
+			last++;
+
+		// at least three segments, otherwise the arc does not save anything
+		size_t fitted = first;
+		for (size_t end = first + 3; end <= last; ++end)
+		{
+			auto a = project(m_MachineCoords[first]);
+			auto b = project(m_MachineCoords[(first + end) / 2]);
+			auto c = project(m_MachineCoords[end]);
+			double d = 2.0 * cross(b - a, c - a);
+			if (std::abs(d) < 1e-12)
+				break;
+			double ab = dot(b - a, b - a), ac = dot(c - a, c - a);
+			ar::mat::Vec2d offset{ ((c - a).y * ab - (b - a).y * ac) / d, ((b - a).x * ac - (c - a).x * ab) / d };
+			auto center = a + offset;
+			double radius = length(offset);
+			if (radius > s_MaxArcRadius)
+				break;
+
+			double sweep = 0.0, direction = 0.0;
+			bool fits = true;
+			for (size_t k = first; k < end && fits; ++k)
+			{
+				auto from = project(m_MachineCoords[k]) - center, to = project(m_MachineCoords[k + 1]) - center;
+				double turn = std::atan2(cross(from, to), dot(from, to));
+				double halfChord = 0.5 * length(to - from);
+				double sagitta = radius - std::sqrt(std::max(radius * radius - halfChord * halfChord, 0.0));
+				if (direction == 0.0)
+					direction = turn;
+				fits = turn * direction > 0.0
+					&& std::abs(length(to) - radius) <= tolerance
+					&& sagitta <= tolerance;
+				sweep += std::abs(turn);
+			}
+			if (!fits || sweep >= 2.0 * std::numbers::pi - 1e-6)
+				break;
+
+			fitted = end;
+			auto start = m_MachineCoords[first];
+			move.Type = direction > 0.0 ? MoveType::ArcCCW : MoveType::ArcCW;
+			move.End = m_MachineCoords[end];
+			move.Center = plane == ArcPlane::XY
+				? ar::mat::Vec3{ static_cast<float>(center.x), static_cast<float>(center.y), start.z }
+				: ar::mat::Vec3{ static_cast<float>(center.y), start.y, static_cast<float>(center.x) };
+			move.Plane = plane;
 		}
-		file.close();
+		return fitted;
 	}
 
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "core/Scene/Entity.h"
 #include "core/Paths/ToolType.h"
+#include "core/Paths/HeightmapGenerator.h"
+#include "core/Paths/GCodeWriter.h"
 #include <filesystem>
 
 namespace ar
@@ -8,12 +10,56 @@ namespace ar
 	class ToolPath
 	{
 	public:
+		struct SimplifyStats
+		{
+			size_t PointsBefore = 0, PointsAfter = 0;
+			inline float ReductionRatio() const
+			{
+				return PointsBefore ? 1.0f - static_cast<float>(PointsAfter) / PointsBefore : 0.0f;
+			}
+		};
+
+		enum class MoveType
+		{
+			Linear,
+			ArcCW,
+			ArcCCW
+		};
+
+		// Move from the previous position; Center and Plane are meaningful only for arcs
+		struct Move
+		{
+			MoveType Type = MoveType::Linear;
+			ar::mat::Vec3 End;
+			ar::mat::Vec3 Center;
+			ArcPlane Plane = ArcPlane::XY;
+		};
+
 		ToolPath(ar::mat::Vec3 startPoint, ToolType type, float baseHeight = 1.5f);
 		void MoveTo(ar::mat::Vec3 point);
 		void MoveBy(ar::mat::Vec3 v);
+		// Continues the path with every point of the segment except its first one,
+		// which is expected to coincide with the current position
+		void Append(const ToolPath& segment);
 		inline const ar::mat::Vec3& GetCurrentPos() { return m_MachineCoords.back(); }
-		void ConvertToGCode(uint32_t order, std::filesystem::path path);
+		inline float GetBaseHeight() const { return m_BaseDisplacement.z; }
+		// Douglas-Peucker pass over the machine coordinates; a chord replaces points only if
+		// the tool tip stays above the offset map along all of it
+		SimplifyStats Simplify(float tolerance, const HeightmapGenerator::ToolOffsetMap& offset);
+		// Replaces runs of planar segments (XY at constant z, ZX at constant y) with circular arcs
+		// whenever every point and every chord stays within the tolerance from the circle
+		std::vector<Move> FitArcs(float tolerance) const;
+		void ConvertToGCode(uint32_t order, std::filesystem::path path, GCodeWriter::Options options = {});
 	private:
+		void AddMachinePoint(ar::mat::Vec3 newPoint);
+		void SimplifyRange(size_t first, size_t last, float tolerance,
+			const HeightmapGenerator::ToolOffsetMap& offset, std::vector<uint8_t>& keep) const;
+		size_t FitArc(size_t first, float tolerance, ArcPlane plane, Move& move) const;
+		bool IsSegmentSafe(ar::mat::Vec3 start, ar::mat::Vec3 end, const HeightmapGenerator::ToolOffsetMap& offset) const;
+
+		static constexpr size_t s_MaxArcPoints = 256;
+		static constexpr float s_MaxArcRadius = 100.0f;
+
 		std::vector<ar::mat::Vec3> m_MachineCoords{};
 		float m_Length;
 		ToolType m_ToolType;
@@ -20,4 +20,25 @@ namespace ar
 		return "error";
 	}
 
+	float ToolTypeRadius(ToolType t)
+	{
+		switch (t)
+		{
+		case ToolType::F10:
+			return 0.5f;
+		case ToolType::K01:
+			return 0.05f;
+		case ToolType::K08:
+			return 0.4f;
+		case ToolType::K16:
+			return 0.8f;
+		}
+		return 0.0f;
+	}
+
+	bool ToolTypeIsFlat(ToolType t)
+	{
+		return t == ToolType::F10;
+	}
+
 }
\ No newline at end of file
@@ -12,4 +12,6 @@ namespace ar
 	};
 
 	std::string ToolTypeStr(ToolType t);
+	float ToolTypeRadius(ToolType t);	// in scene units (cm)
+	bool ToolTypeIsFlat(ToolType t);
 }
\ No newline at end of file
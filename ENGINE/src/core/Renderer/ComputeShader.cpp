@@ -5,12 +5,12 @@
 
 namespace ar
 {
-	ComputeShader* ComputeShader::Create(const std::string& path)
+	ComputeShader* ComputeShader::Create(const std::string& path, const std::vector<std::string>& defines)
 	{
 		switch (RendererAPI::GetAPI())
 		{
 		case RendererAPI::API::None: return nullptr;
-		case RendererAPI::API::OpenGL: return new OGLComputeShader(path);
+		case RendererAPI::API::OpenGL: return new OGLComputeShader(path, defines);
 		default:
 			AR_ASSERT(false, "Uknown renderer");
 			return nullptr;
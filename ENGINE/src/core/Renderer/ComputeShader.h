@@ -8,7 +8,8 @@ namespace ar
 		virtual ~ComputeShader() {}
 
 		virtual void Use() const = 0;
-		static ComputeShader* Create(const std::string& path);
+		// every define is added as "#define <define>" right after the #version line
+		static ComputeShader* Create(const std::string& path, const std::vector<std::string>& defines = {});
 		virtual void SetFloat(const std::string& name, float value) const = 0;
 		virtual void SetBool(const std::string& name, bool value) const = 0;
 		virtual void SetUInt(const std::string& name, uint32_t value) const = 0;
@@ -27,6 +27,10 @@ namespace ar
 		{
 			glGetNamedBufferSubData(m_ID, 0, size, dst);
 		}
+		void ReadSubData(void* dst, size_t offset, size_t size)
+		{
+			glGetNamedBufferSubData(m_ID, offset, size, dst);
+		}
 
 	private:
 		uint32_t m_ID;
@@ -5,6 +5,7 @@ namespace ar
 	enum class TextureFormat
 	{
 		R8,
+		R16,	// unsigned normalized
 		R32,
 		R32F,
 		RGBA8,
@@ -24,7 +25,15 @@ namespace ar
 		virtual ~Texture() {}
 		virtual void Resize(uint32_t width, uint32_t height) = 0;
 		virtual void UpdateData(void* data, uint32_t size = 0) = 0;
+		// uploads a width x height block at (x, y); data holds the whole image, rows Width texels apart
+		virtual void UpdateRegion(void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height) = 0;
+		// uploads a width x height block at (x, y); data holds just the block, rows stride texels apart
+		virtual void UpdateBlock(const void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride) = 0;
+		// sets every texel to value, a single texel in the upload format
+		virtual void Clear(const void* value) = 0;
 		virtual void SetData(void* data, uint32_t size) = 0;
+		// size of the destination in bytes
+		virtual void ReadData(void* data, uint32_t size) = 0;
 		static Texture* Create(const TextureDesc& desc);
 		static Texture* Create(const std::string& filepath);
 		inline const uint32_t GetID() const { return m_ID; };
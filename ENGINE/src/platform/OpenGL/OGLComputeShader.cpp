@@ -3,9 +3,13 @@
 
 namespace ar
 {
-	OGLComputeShader::OGLComputeShader(const std::string& path)
+	OGLComputeShader::OGLComputeShader(const std::string& path, const std::vector<std::string>& defines)
 	{
 		std::string src = LoadSource(path);
+		// defines have to follow the #version directive
+		auto afterVersion = src.find('\n') + 1;
+		for (auto it = defines.rbegin(); it != defines.rend(); ++it)
+			src.insert(afterVersion, "#define " + *it + "\n");
 		auto shader = CompileShader(GL_COMPUTE_SHADER, src);
 		LinkProgram(shader);
 		DeleteShader(shader);
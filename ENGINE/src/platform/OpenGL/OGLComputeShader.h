@@ -9,7 +9,7 @@ namespace ar
 	class OGLComputeShader : public ComputeShader
 	{
 	public:
-		OGLComputeShader(const std::string& path);
+		OGLComputeShader(const std::string& path, const std::vector<std::string>& defines = {});
 		~OGLComputeShader();
 		void Use() const override;
 		
@@ -94,23 +94,74 @@ namespace ar
 		else
 		{
 			GLenum format = GetDataFormat(m_Description.Format);
-			GLenum type = GL_UNSIGNED_BYTE;
-			if (m_Description.Format == TextureFormat::R32)
-				type = GL_UNSIGNED_INT;
-			if (m_Description.Format == TextureFormat::R32F)
-				type = GL_FLOAT;
+			GLenum type = GetDataType(m_Description.Format);
 
+			// rows are tightly packed, R16 rows of odd width are not 4-byte aligned
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 			glTextureSubImage2D(m_ID, 0, 0, 0, m_Description.Width, m_Description.Height,
 				format, type, data);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 			AR_GL_CHECK();
 		}
 	}
 
+	void OGLTexture::UpdateRegion(void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+	{
+		AR_ASSERT(m_Description.Format != TextureFormat::D24S8, "Renderbuffers cannot be updated");
+		GLenum format = GetDataFormat(m_Description.Format);
+		GLenum type = GetDataType(m_Description.Format);
+
+		// let GL pick the block out of the full image instead of copying it
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, m_Description.Width);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTextureSubImage2D(m_ID, 0, x, y, width, height, format, type, data);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		AR_GL_CHECK();
+	}
+
+	void OGLTexture::UpdateBlock(const void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride)
+	{
+		AR_ASSERT(m_Description.Format != TextureFormat::D24S8, "Renderbuffers cannot be updated");
+		GLenum format = GetDataFormat(m_Description.Format);
+		GLenum type = GetDataType(m_Description.Format);
+
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTextureSubImage2D(m_ID, 0, x, y, width, height, format, type, data);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		AR_GL_CHECK();
+	}
+
+	void OGLTexture::Clear(const void* value)
+	{
+		AR_ASSERT(m_Description.Format != TextureFormat::D24S8, "Renderbuffers cannot be cleared");
+		glClearTexImage(m_ID, 0, GetDataFormat(m_Description.Format), GetDataType(m_Description.Format), value);
+		AR_GL_CHECK();
+	}
+
 	void OGLTexture::SetData(void* data, uint32_t size)
 	{
 		throw std::logic_error("The method or operation is not implemented.");
 	}
 
+	void OGLTexture::ReadData(void* data, uint32_t size)
+	{
+		AR_ASSERT(m_Description.Format != TextureFormat::D24S8, "Renderbuffers cannot be read back");
+		GLenum format = GetDataFormat(m_Description.Format);
+		GLenum type = GetDataType(m_Description.Format);
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTextureImage(m_ID, 0, format, type, size, data);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		AR_GL_CHECK();
+	}
+
 	void OGLTexture::Resize(uint32_t width, uint32_t height)
 	{
 		m_Description.Width = width;
@@ -144,6 +195,7 @@ namespace ar
 		{
 		case TextureFormat::R8: return GL_RED_INTEGER;
 		case TextureFormat::R32: return GL_RED_INTEGER;
+		case TextureFormat::R16: return GL_RED;
 		case TextureFormat::R32F: return GL_RED;
 		case TextureFormat::RGBA8: return GL_RGBA;
 		case TextureFormat::D24S8:
@@ -153,6 +205,17 @@ namespace ar
 		}
 	}
 
+	GLenum OGLTexture::GetDataType(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::R16: return GL_UNSIGNED_SHORT;
+		case TextureFormat::R32: return GL_UNSIGNED_INT;
+		case TextureFormat::R32F: return GL_FLOAT;
+		default: return GL_UNSIGNED_BYTE;
+		}
+	}
+
 	GLenum OGLTexture::GetGLInternalFormat(TextureFormat format)
 	{
 		switch (format)
@@ -160,6 +223,7 @@ namespace ar
 		case TextureFormat::R8: return GL_R8;
 		case TextureFormat::RGBA8: return GL_RGBA8;
 		case TextureFormat::R32: return GL_R32UI;
+		case TextureFormat::R16: return GL_R16;
 		case TextureFormat::R32F: return GL_R32F;
 		case TextureFormat::D24S8:
 		default:
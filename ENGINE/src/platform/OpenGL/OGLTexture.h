@@ -13,10 +13,15 @@ namespace ar
 		virtual ~OGLTexture();
 		void Resize(uint32_t width, uint32_t height) override;
 		void UpdateData(void* data, uint32_t size = 0) override;
+		void UpdateRegion(void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
+		void UpdateBlock(const void* data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t stride) override;
+		void Clear(const void* value) override;
 		void SetData(void* data, uint32_t size) override;
+		void ReadData(void* data, uint32_t size) override;
 
 	private:
 		GLenum GetDataFormat(TextureFormat format);
+		GLenum GetDataType(TextureFormat format);
 		GLenum GetGLInternalFormat(TextureFormat format);
 
 		TextureDesc m_Description;
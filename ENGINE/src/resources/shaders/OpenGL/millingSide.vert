@@ -10,6 +10,7 @@ out vec3 WorldPosFrag;
 out vec3 NormFrag;
 
 uniform sampler2D u_Heightmap;
+uniform float u_HeightScale;	// 1 for R32F, the stock height for normalized R16
 
 void main()
 {
@@ -17,6 +18,6 @@ void main()
 	if (a_TexCoord.x < -0.5 || a_TexCoord.y < -0.5)
 		WorldPosFrag = a_Position;
 	else
-		WorldPosFrag = a_Position + vec3(0.0f, 1.0f, 0.0f) * texture(u_Heightmap, a_TexCoord).r;
+		WorldPosFrag = a_Position + vec3(0.0f, 1.0f, 0.0f) * texture(u_Heightmap, a_TexCoord).r * u_HeightScale;
 	gl_Position = u_VP * vec4(WorldPosFrag, 1.0);
 }
\ No newline at end of file
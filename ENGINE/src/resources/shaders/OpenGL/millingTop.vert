@@ -1,21 +1,24 @@
 #version 450 core
 
-layout (location = 0) in vec3 a_Position;  
-layout (location = 1) in vec3 a_Normal;
-layout (location = 2) in vec2 a_TexCoord;
-
 uniform mat4 u_VP;
+uniform vec2 u_Size;		// x and z of the stock
+uniform vec2 u_LastTexel;	// samples - 1 along x and z
+uniform float u_BaseHeight;
 
 out vec3 WorldPosFrag;
 out vec3 NormFrag;
 out vec2 TexCoordFrag;
 
 uniform sampler2D u_Heightmap;
+uniform float u_HeightScale;	// 1 for R32F, the stock height for normalized R16
 
 void main()
 {
-	NormFrag = a_Normal;
-	WorldPosFrag = a_Position + NormFrag * texture(u_Heightmap, a_TexCoord).r;
-	TexCoordFrag = a_TexCoord;
+	// instance i is the strip between grid rows i and i + 1, its vertices alternate between them
+	vec2 grid = vec2(gl_VertexID / 2, gl_InstanceID + gl_VertexID % 2) / u_LastTexel;
+	TexCoordFrag = vec2(grid.x, 1.0 - grid.y);
+	NormFrag = vec3(0.0, 1.0, 0.0);
+	WorldPosFrag = vec3((grid.x - 0.5) * u_Size.x, u_BaseHeight, (grid.y - 0.5) * u_Size.y);
+	WorldPosFrag += NormFrag * texture(u_Heightmap, TexCoordFrag).r * u_HeightScale;
 	gl_Position = u_VP * vec4(WorldPosFrag, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,110 @@
+#include "BatchSimulation.h"
+#include "Milling/CpuMillingEngine.h"
+#include "Tools/GCodeTools.h"
+#include "Tools/StringTools.h"
+#include <algorithm>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static float ElapsedMs(Clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+BatchSimulation::BatchSimulation(const MaterialDesc& material, MillingMode mode, size_t windowSize,
+	const MachineLimits& machine)
+	: m_Material(material), m_Mode(mode), m_WindowSize(windowSize), m_Machine(machine),
+	m_Heights(material)
+{
+}
+
+const BatchProgramResult& BatchSimulation::Run(const fs::path& filepath, const fs::path& next)
+{
+	BatchProgramResult& result = m_Results.emplace_back();
+	result.Filepath = filepath;
+
+	// the previous run may have parsed this program already
+	if (!m_Prefetch.IsStarted() || m_Prefetch.GetFilepath() != filepath)
+	{
+		if (m_Prefetch.IsStarted())
+			m_Prefetch.Take();
+		m_Prefetch.Start(filepath, m_WindowSize);
+	}
+	auto program = m_Prefetch.Take();
+	if (!next.empty())
+		m_Prefetch.Start(next, m_WindowSize);
+
+	// same convention as the interactive simulator: .k16 is a round 16 mm cutter, .f10 a flat 10 mm one
+	auto extension = StringTools::LeftTrim(filepath.extension().string(), 1);
+	try
+	{
+		result.Cutter = GCodeTools::GetCutter(extension);
+	}
+	catch (const std::exception&)
+	{
+		result.ParseError = "Cutter type and size can not be read from the extension";
+		return result;
+	}
+	auto params = GetParams(result.Cutter);
+
+	auto& stream = *program.Stream;
+	std::vector<ar::mat::Vec4> window = std::move(program.FirstWindow);
+	result.ParseTime = program.ParseTime;
+	MillingErrorLog log;
+	std::vector<float> volumes;
+	// texels stopped by an error stay stopped in later windows, so the result does not depend on the window size
+	std::vector<uint32_t> stopped;
+	uint64_t windowStart = 0;	// program index of the window's first point
+	MachiningTime machining(m_Machine);
+	// the first window comes from the prefetch
+	for (bool read = !window.empty() && !stream.HasError(); read; )
+	{
+		// consecutive windows share a point, count it once
+		result.Points += window.size() - (result.Windows > 0 ? 1 : 0);
+		machining.Add(window);
+		result.Windows++;
+
+		auto start = Clock::now();
+		auto error = CpuMillingEngine::Mill(m_Heights, window, params, m_Mode, nullptr, &log, &volumes, &stopped);
+		result.MillTime += ElapsedMs(start);
+		result.Removal.Add(windowStart, window, volumes);
+
+		for (auto& record : log.Records)
+			result.Located.push_back({ windowStart + record.Segment, record.Kind, record.TexelX, record.TexelY });
+		result.DroppedErrors += log.Dropped;
+		windowStart += window.size() - 1;
+
+		result.Error.NonCuttingContact |= error.NonCuttingContact;
+		result.Error.OverPlunge |= error.OverPlunge;
+		result.Error.DownMilling |= error.DownMilling;
+
+		start = Clock::now();
+		read = stream.NextWindow(window);
+		result.ParseTime += ElapsedMs(start);
+	}
+	result.ParseError = stream.GetError();
+	result.Machining = machining.Finish();
+	return result;
+}
+
+bool BatchSimulation::HasFailures() const
+{
+	return std::any_of(m_Results.begin(), m_Results.end(), [](const auto& result) { return result.Failed(); });
+}
+
+MillingParams BatchSimulation::GetParams(const CutterDesc& cutter) const
+{
+	// mirrors Heightmap::GetParams
+	MillingParams params;
+	params.Profile = std::make_shared<const CutterProfile>(cutter);
+	params.CutterRadius = params.Profile->GetRadius();
+	params.CutterHeight = params.Profile->GetCuttingLength();
+	params.ContactTolerance = HeightField::GetPrecision(m_Material);
+	params.BaseHeight = m_Material.BaseHeight;
+	params.TexelWidth = m_Material.Size.x / (m_Material.Samples.u - 1);
+	params.TexelHeight = m_Material.Size.z / (m_Material.Samples.v - 1);
+	params.OffsetX = -m_Material.Size.x / 2.0f;
+	params.OffsetY = -m_Material.Size.z / 2.0f;
+	return params;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "Milling/MaterialDesc.h"
+#include "Milling/HeightField.h"
+#include "Milling/MillingParams.h"
+#include "Milling/MillingError.h"
+#include "Milling/RemovalStats.h"
+#include "Tools/GCodeStream.h"
+#include "Tools/ProgramPrefetch.h"
+#include "Tools/MachiningTime.h"
+
+namespace fs = std::filesystem;
+
+struct BatchProgramResult
+{
+	fs::path Filepath;
+	CutterDesc Cutter;	// as encoded in the extension
+	size_t Points = 0;
+	size_t Windows = 0;
+	MillingError Error;
+	std::vector<LocatedMillingError> Located;
+	uint32_t DroppedErrors = 0;	// located errors past the log capacity
+	std::string ParseError;	// empty if the whole program was read
+	float ParseTime = 0.0f, MillTime = 0.0f;	// in ms
+	RemovalStats Removal;
+	MachiningEstimate Machining;	// of the moves read, at the programmed feeds
+
+	inline bool Failed() const
+	{
+		return !ParseError.empty() || Error.NonCuttingContact || Error.OverPlunge || Error.DownMilling;
+	}
+};
+
+// Mills programs one after another into a single stock with the CPU engine, no window or GL context needed
+class BatchSimulation
+{
+public:
+	BatchSimulation(const MaterialDesc& material, MillingMode mode = MillingMode::Gather,
+		size_t windowSize = GCodeStream::s_DefaultWindowSize, const MachineLimits& machine = {});
+
+	// runs the program to completion on the current stock; next, if given, is opened and parsed
+	// on a worker thread meanwhile
+	const BatchProgramResult& Run(const fs::path& filepath, const fs::path& next = {});
+
+	inline const MaterialDesc& GetMaterial() const { return m_Material; }
+	inline const HeightField& GetHeights() const { return m_Heights; }
+	inline const std::vector<BatchProgramResult>& GetResults() const { return m_Results; }
+	bool HasFailures() const;
+
+private:
+	MillingParams GetParams(const CutterDesc& cutter) const;
+
+	MaterialDesc m_Material;
+	MillingMode m_Mode;
+	size_t m_WindowSize;
+	MachineLimits m_Machine;
+	HeightField m_Heights;
+	std::vector<BatchProgramResult> m_Results;
+	ProgramPrefetch m_Prefetch;
+};
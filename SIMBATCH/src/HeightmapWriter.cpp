@@ -0,0 +1,166 @@
+#include "HeightmapWriter.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <fmt/format.h>
+
+bool HeightmapWriter::GetFormat(const fs::path& filepath, HeightmapFormat& format)
+{
+	auto extension = filepath.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+	if (extension == ".raw")
+		format = HeightmapFormat::Raw;
+	else if (extension == ".pgm")
+		format = HeightmapFormat::PGM;
+	else if (extension == ".exr")
+		format = HeightmapFormat::EXR;
+	else
+		return false;
+	return true;
+}
+
+bool HeightmapWriter::Write(const fs::path& filepath, HeightmapFormat format, const HeightField& heights, float maxHeight)
+{
+	if (format == HeightmapFormat::Raw && heights.GetFormat() == HeightFormat::Float32 && !heights.IsSparse())
+	{
+		std::ofstream file(filepath, std::ios::binary);
+		file.write(static_cast<const char*>(heights.GetData()), heights.GetByteSize());
+		return file.good();
+	}
+	return Write(filepath, format, heights.GetSamplesX(), heights.GetSamplesY(), [&heights](uint32_t y, float* line)
+		{
+			heights.ReadBlock(0, y, heights.GetSamplesX(), 1, line, heights.GetSamplesX());
+		}, 0.0f, maxHeight);
+}
+
+bool HeightmapWriter::Write(const fs::path& filepath, HeightmapFormat format, const std::vector<float>& values,
+	uint32_t samplesX, uint32_t samplesY, float minValue, float maxValue)
+{
+	if (values.size() != static_cast<size_t>(samplesX) * samplesY)
+		return false;
+	return Write(filepath, format, samplesX, samplesY, [&](uint32_t y, float* line)
+		{
+			std::copy_n(values.data() + static_cast<size_t>(y) * samplesX, samplesX, line);
+		}, minValue, maxValue);
+}
+
+bool HeightmapWriter::Write(const fs::path& filepath, HeightmapFormat format, uint32_t samplesX, uint32_t samplesY,
+	const LineReader& readLine, float minValue, float maxValue)
+{
+	std::ofstream file(filepath, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	switch (format)
+	{
+	case HeightmapFormat::Raw: return WriteRaw(file, samplesX, samplesY, readLine);
+	case HeightmapFormat::PGM: return WritePGM(file, samplesX, samplesY, readLine, minValue, maxValue);
+	case HeightmapFormat::EXR: return WriteEXR(file, samplesX, samplesY, readLine);
+	}
+	return false;
+}
+
+bool HeightmapWriter::WriteRaw(std::ofstream& file, uint32_t samplesX, uint32_t samplesY, const LineReader& readLine)
+{
+	std::vector<float> line(samplesX);
+	for (uint32_t y = 0; y < samplesY; ++y)
+	{
+		readLine(y, line.data());
+		file.write(reinterpret_cast<const char*>(line.data()), line.size() * sizeof(float));
+	}
+	return file.good();
+}
+
+bool HeightmapWriter::WritePGM(std::ofstream& file, uint32_t samplesX, uint32_t samplesY, const LineReader& readLine,
+	float minValue, float maxValue)
+{
+	auto header = fmt::format("P5\n# values {} - {} cm\n{} {}\n65535\n", minValue, maxValue, samplesX, samplesY);
+	file.write(header.data(), header.size());
+
+	// 16-bit samples are big-endian
+	std::vector<float> line(samplesX);
+	std::vector<uint8_t> data(static_cast<size_t>(samplesX) * 2);
+	float scale = maxValue > minValue ? 65535.0f / (maxValue - minValue) : 0.0f;
+	for (uint32_t y = 0; y < samplesY; ++y)
+	{
+		readLine(y, line.data());
+		for (uint32_t i = 0; i < samplesX; ++i)
+		{
+			auto value = static_cast<uint16_t>(std::clamp((line[i] - minValue) * scale + 0.5f, 0.0f, 65535.0f));
+			data[2 * i] = static_cast<uint8_t>(value >> 8);
+			data[2 * i + 1] = static_cast<uint8_t>(value & 0xFF);
+		}
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+	return file.good();
+}
+
+bool HeightmapWriter::WriteEXR(std::ofstream& file, uint32_t samplesX, uint32_t samplesY, const LineReader& readLine)
+{
+	// minimal OpenEXR 2.0 scanline file: one FLOAT channel "Y", NO_COMPRESSION, one line per chunk;
+	// all fields are little-endian like the target platforms, so values are copied as they are
+	std::vector<char> buffer;
+	auto put = [&buffer](const void* data, size_t size)
+	{
+		auto bytes = static_cast<const char*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	};
+	auto putInt = [&put](int32_t value) { put(&value, sizeof(value)); };
+	auto putFloat = [&put](float value) { put(&value, sizeof(value)); };
+	auto putAttribute = [&put, &putInt](const char* name, const char* type, int32_t size)
+	{
+		put(name, std::strlen(name) + 1);
+		put(type, std::strlen(type) + 1);
+		putInt(size);
+	};
+
+	const uint8_t magic[] = { 0x76, 0x2F, 0x31, 0x01 };
+	put(magic, sizeof(magic));
+	putInt(2);	// version 2, single-part scanline
+
+	int32_t maxX = static_cast<int32_t>(samplesX) - 1, maxY = static_cast<int32_t>(samplesY) - 1;
+	putAttribute("channels", "chlist", 2 + 16 + 1);
+	put("Y", 2);
+	putInt(2);	// FLOAT
+	putInt(0);	// pLinear and reserved bytes
+	putInt(1);	// x sampling
+	putInt(1);	// y sampling
+	buffer.push_back(0);
+	putAttribute("compression", "compression", 1);
+	buffer.push_back(0);	// NO_COMPRESSION
+	putAttribute("dataWindow", "box2i", 16);
+	putInt(0); putInt(0); putInt(maxX); putInt(maxY);
+	putAttribute("displayWindow", "box2i", 16);
+	putInt(0); putInt(0); putInt(maxX); putInt(maxY);
+	putAttribute("lineOrder", "lineOrder", 1);
+	buffer.push_back(0);	// INCREASING_Y
+	putAttribute("pixelAspectRatio", "float", 4);
+	putFloat(1.0f);
+	putAttribute("screenWindowCenter", "v2f", 8);
+	putFloat(0.0f); putFloat(0.0f);
+	putAttribute("screenWindowWidth", "float", 4);
+	putFloat(1.0f);
+	buffer.push_back(0);	// end of header
+
+	// offset table, then every line prefixed with its y and byte count
+	uint64_t lineBytes = samplesX * sizeof(float);
+	uint64_t offset = buffer.size() + samplesY * sizeof(uint64_t);
+	for (uint32_t y = 0; y < samplesY; ++y)
+	{
+		put(&offset, sizeof(offset));
+		offset += 2 * sizeof(int32_t) + lineBytes;
+	}
+	file.write(buffer.data(), buffer.size());
+
+	std::vector<float> values(samplesX);
+	for (uint32_t y = 0; y < samplesY; ++y)
+	{
+		int32_t line[] = { static_cast<int32_t>(y), static_cast<int32_t>(lineBytes) };
+		file.write(reinterpret_cast<const char*>(line), sizeof(line));
+		readLine(y, values.data());
+		file.write(reinterpret_cast<const char*>(values.data()), lineBytes);
+	}
+	return file.good();
+}
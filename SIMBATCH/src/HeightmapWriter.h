@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <functional>
+#include "Milling/HeightField.h"
+
+namespace fs = std::filesystem;
+
+enum class HeightmapFormat
+{
+	Raw,	// bare little-endian float32 heights, row-major
+	PGM,	// 16-bit binary graymap, heights scaled to the full range
+	EXR		// single float channel, uncompressed scanlines
+};
+
+// Dumps the milled heights (in cm above the base) for offline inspection and diffing; fixed-point
+// stocks are decoded a line at a time, so every format looks the same whatever the storage
+class HeightmapWriter
+{
+public:
+	// picks the format from the extension (.raw, .pgm, .exr), returns false for anything else
+	static bool GetFormat(const fs::path& filepath, HeightmapFormat& format);
+	// maxHeight maps to white in the PGM output, the other formats keep the heights as they are
+	static bool Write(const fs::path& filepath, HeightmapFormat format, const HeightField& heights, float maxHeight);
+	// any other row-major image, such as a signed deviation map; the PGM output maps minValue to black
+	static bool Write(const fs::path& filepath, HeightmapFormat format, const std::vector<float>& values,
+		uint32_t samplesX, uint32_t samplesY, float minValue, float maxValue);
+
+private:
+	// fills a line of samplesX values
+	using LineReader = std::function<void(uint32_t y, float* line)>;
+
+	static bool Write(const fs::path& filepath, HeightmapFormat format, uint32_t samplesX, uint32_t samplesY,
+		const LineReader& readLine, float minValue, float maxValue);
+	static bool WriteRaw(std::ofstream& file, uint32_t samplesX, uint32_t samplesY, const LineReader& readLine);
+	static bool WritePGM(std::ofstream& file, uint32_t samplesX, uint32_t samplesY, const LineReader& readLine,
+		float minValue, float maxValue);
+	static bool WriteEXR(std::ofstream& file, uint32_t samplesX, uint32_t samplesY, const LineReader& readLine);
+};
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include "BatchSimulation.h"
+#include "HeightmapWriter.h"
+#include "Milling/StockMesh.h"
+#include "Milling/DeviationAnalysis.h"
+#include "Tests/SimTests.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <fmt/format.h>
+
+// Headless simulator for overnight verification of generated programs:
+//   SIMBATCH [options] -o <heightmap.raw|.pgm|.exr> <program>...
+//   SIMBATCH --self-test
+// Exit code is 0 when every program ran clean, 1 when any program failed, 2 on bad arguments or I/O errors.
+
+static constexpr const char* s_Usage =
+	"usage: SIMBATCH [options] -o <heightmap.raw|.pgm|.exr> <program.k16|.f10|...>...\n"
+	"       SIMBATCH --self-test  run the milling checks, exit code 1 when one fails\n"
+	"  --samples <x> <y>      heightmap resolution (default 1500 1500)\n"
+	"  --size <x> <y> <z>     stock size in cm (default 15 5 15)\n"
+	"  --base <height>        base height in cm (default 1.5)\n"
+	"  --mode <gather|stamp>  CPU milling mode (default gather)\n"
+	"  --heights <float|fixed16>  height storage, fixed16 halves the memory (default float)\n"
+	"  --sparse               keep heights in tiles allocated when first milled\n"
+	"  --window <points>      points held in memory per program window\n"
+	"  --rapid <mm/min>       G00 feed for the time estimate (default 10000)\n"
+	"  --feed <mm/min>        feed of moves before the first F (default 1000)\n"
+	"  --accel <mm/s^2>       acceleration limit for the time estimate (default none)\n"
+	"  --report <file>        also write the report to a file\n"
+	"  --mesh <file.stl|.obj> also export the milled stock as a decimated mesh\n"
+	"  --target <design.hm>   compare the stock with the design heights after every program\n"
+	"  --deviation <file.raw|.pgm|.exr>  also write the final signed deviation from the target\n"
+	"  --tolerance <cm>       deeper cuts below the target count as gouges (default 0.01)\n"
+	"  --range <cm>           deviation histogram spans +-range (default 0.5)\n"
+	"  --removal <dir>        write a per-move removal table <program>.csv for every program\n";
+
+struct BatchArgs
+{
+	MaterialDesc Material;
+	MillingMode Mode = MillingMode::Gather;
+	size_t WindowSize = GCodeStream::s_DefaultWindowSize;
+	MachineLimits Machine;
+	fs::path Output, Report, Removal, Mesh, Target, Deviation;
+	float Tolerance = 0.01f, Range = 0.5f;
+	std::vector<fs::path> Programs;
+};
+
+static bool ParseArgs(int argc, char** argv, BatchArgs& args)
+{
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			auto next = [&]() -> std::string
+			{
+				if (i + 1 >= argc)
+					throw std::invalid_argument(arg);
+				return argv[++i];
+			};
+
+			if (arg == "-o" || arg == "--output")
+				args.Output = next();
+			else if (arg == "--report")
+				args.Report = next();
+			else if (arg == "--removal")
+				args.Removal = next();
+			else if (arg == "--mesh")
+				args.Mesh = next();
+			else if (arg == "--target")
+				args.Target = next();
+			else if (arg == "--deviation")
+				args.Deviation = next();
+			else if (arg == "--tolerance")
+				args.Tolerance = std::stof(next());
+			else if (arg == "--range")
+				args.Range = std::stof(next());
+			else if (arg == "--samples")
+			{
+				args.Material.Samples.u = std::stoul(next());
+				args.Material.Samples.v = std::stoul(next());
+			}
+			else if (arg == "--size")
+			{
+				args.Material.Size.x = std::stof(next());
+				args.Material.Size.y = std::stof(next());
+				args.Material.Size.z = std::stof(next());
+			}
+			else if (arg == "--base")
+				args.Material.BaseHeight = std::stof(next());
+			else if (arg == "--mode")
+			{
+				auto mode = next();
+				if (mode != "gather" && mode != "stamp")
+					return false;
+				args.Mode = mode == "stamp" ? MillingMode::Stamp : MillingMode::Gather;
+			}
+			else if (arg == "--heights")
+			{
+				auto heights = next();
+				if (heights != "float" && heights != "fixed16")
+					return false;
+				args.Material.Format = heights == "fixed16" ? HeightFormat::Fixed16 : HeightFormat::Float32;
+			}
+			else if (arg == "--sparse")
+				args.Material.Sparse = true;
+			else if (arg == "--window")
+				args.WindowSize = std::stoull(next());
+			else if (arg == "--rapid")
+				args.Machine.RapidFeed = std::stof(next());
+			else if (arg == "--feed")
+				args.Machine.DefaultFeed = std::stof(next());
+			else if (arg == "--accel")
+				args.Machine.Acceleration = std::stof(next());
+			else if (arg.starts_with("-"))
+				return false;
+			else
+				args.Programs.emplace_back(arg);
+		}
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	auto& material = args.Material;
+	if (!args.Deviation.empty() && args.Target.empty())
+		return false;
+	if (args.Machine.RapidFeed <= 0.0f || args.Machine.DefaultFeed <= 0.0f || args.Machine.Acceleration < 0.0f)
+		return false;
+	return !args.Output.empty() && !args.Programs.empty() && args.WindowSize > 1 && args.Range > 0.0f &&
+		material.Samples.u > 1 && material.Samples.v > 1 && material.BaseHeight < material.Size.y;
+}
+
+static const char* FormatKind(MillingErrorKind kind)
+{
+	switch (kind)
+	{
+	case MillingErrorKind::NonCuttingContact: return "non-cutting-contact";
+	case MillingErrorKind::OverPlunge: return "over-plunge";
+	case MillingErrorKind::DownMilling: return "down-milling";
+	}
+	return "unknown";
+}
+
+static std::string FormatErrors(const MillingError& error)
+{
+	std::string result;
+	if (error.DownMilling) result += " down-milling";
+	if (error.NonCuttingContact) result += " non-cutting-contact";
+	if (error.OverPlunge) result += " over-plunge";
+	return result.empty() ? " none" : result;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 2 && std::string(argv[1]) == "--self-test")
+		return SimTests::TestMillingSuite() ? 0 : 1;
+
+	BatchArgs args;
+	HeightmapFormat format, deviationFormat;
+	if (!ParseArgs(argc, argv, args) || !HeightmapWriter::GetFormat(args.Output, format) ||
+		(!args.Deviation.empty() && !HeightmapWriter::GetFormat(args.Deviation, deviationFormat)))
+	{
+		std::fputs(s_Usage, stderr);
+		return 2;
+	}
+	DesignHeightmap design;
+	if (!args.Target.empty() && !design.Load(args.Target))
+	{
+		std::fputs(fmt::format("could not read design heights {}\n", args.Target.string()).c_str(), stderr);
+		return 2;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto& material = args.Material;
+	// progress goes to stdout as it happens, the report file gets the same lines
+	std::string report;
+	auto print = [&report](const std::string& line)
+	{
+		std::fputs(line.c_str(), stdout);
+		report += line;
+	};
+	print(fmt::format("stock {}x{} samples, {} x {} x {} cm, base {} cm, {}{} heights, {} mode\n",
+		material.Samples.u, material.Samples.v, material.Size.x, material.Size.y, material.Size.z,
+		material.BaseHeight, material.Sparse ? "sparse " : "", material.Format == HeightFormat::Fixed16 ? "fixed16" : "float",
+		args.Mode == MillingMode::Stamp ? "stamp" : "gather"));
+
+	BatchSimulation simulation(material, args.Mode, args.WindowSize, args.Machine);
+	std::optional<DeviationAnalysis> analysis;
+	if (!args.Target.empty())
+		analysis.emplace(design, material);
+	DeviationReport deviation;
+	std::vector<float> difference;
+	bool written = true;
+	double machiningTime = 0.0;	// in s, of all programs
+	for (size_t i = 0; i < args.Programs.size(); ++i)
+	{
+		// the next program is parsed while this one is milled
+		const auto& program = args.Programs[i];
+		auto& result = simulation.Run(program, i + 1 < args.Programs.size() ? args.Programs[i + 1] : fs::path());
+		print(fmt::format("{}: {}, {} points in {} windows, parse {:.1f} ms, mill {:.1f} ms, errors:{}\n",
+			program.filename().string(), result.Cutter.GetName(),
+			result.Points, result.Windows, result.ParseTime, result.MillTime, FormatErrors(result.Error)));
+		if (!result.ParseError.empty())
+			print(fmt::format("  parse error: {}\n", result.ParseError));
+		for (auto& error : result.Located)
+			print(fmt::format("  move {}: {} at texel ({}, {})\n", error.Move, FormatKind(error.Kind), error.TexelX, error.TexelY));
+		if (result.DroppedErrors)
+			print(fmt::format("  {} more errors not recorded\n", result.DroppedErrors));
+		print(fmt::format("  removed {:.3f} cm^3, {} air cuts\n", result.Removal.GetTotalVolume(), result.Removal.CountAirCuts()));
+		print(fmt::format("  machining {}: cutting {:.1f} cm in {}, rapid {:.1f} cm in {}\n",
+			MachiningTime::Format(result.Machining.GetTotal()), result.Machining.CuttingLength,
+			MachiningTime::Format(result.Machining.CuttingTime), result.Machining.RapidLength,
+			MachiningTime::Format(result.Machining.RapidTime)));
+		machiningTime += result.Machining.GetTotal();
+		if (!args.Removal.empty())
+		{
+			auto table = args.Removal / program.filename();
+			table += ".csv";
+			if (!result.Removal.Export(table))
+			{
+				print(fmt::format("  could not write {}\n", table.string()));
+				written = false;
+			}
+		}
+		if (analysis)
+		{
+			// the deviation image is only kept for the final stock
+			auto compareStart = std::chrono::steady_clock::now();
+			bool last = i + 1 == args.Programs.size() && !args.Deviation.empty();
+			deviation = analysis->Compare(simulation.GetHeights(), args.Range, args.Tolerance, last ? &difference : nullptr);
+			print(fmt::format("  deviation: gouge {:.4f} cm, leftover {:.4f} cm, rms {:.4f} cm, {} of {} texels gouged, {:.1f} ms\n",
+				deviation.MaxGouge, deviation.MaxLeftover, deviation.Rms, deviation.Gouged, deviation.Compared,
+				std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - compareStart).count()));
+		}
+	}
+
+	if (analysis && deviation.Compared)
+	{
+		// empty bins are left out, the end bins also hold everything past the range
+		print(fmt::format("deviation histogram, cm:\n"));
+		float binWidth = 2 * deviation.Range / DeviationAnalysis::s_Bins;
+		for (uint32_t bin = 0; bin < DeviationAnalysis::s_Bins; ++bin)
+			if (deviation.Histogram[bin])
+				print(fmt::format("  {:+.3f} .. {:+.3f}: {:6.2f}%\n", -deviation.Range + bin * binWidth,
+					-deviation.Range + (bin + 1) * binWidth, 100.0 * deviation.Histogram[bin] / deviation.Compared));
+	}
+	if (!args.Deviation.empty())
+	{
+		bool deviationWritten = HeightmapWriter::Write(args.Deviation, deviationFormat, difference,
+			material.Samples.u, material.Samples.v, -args.Range, args.Range);
+		written &= deviationWritten;
+		print(fmt::format("write {}\n", deviationWritten ? args.Deviation.string() : "failed"));
+	}
+
+	print(fmt::format("machining {} in total\n", MachiningTime::Format(machiningTime)));
+	print(fmt::format("heights {:.1f} MB\n", simulation.GetHeights().GetMemoryUsage() / (1024.0 * 1024.0)));
+	auto writeStart = std::chrono::steady_clock::now();
+	bool heightmapWritten = HeightmapWriter::Write(args.Output, format, simulation.GetHeights(),
+		material.Size.y - material.BaseHeight);
+	auto now = std::chrono::steady_clock::now();
+	written &= heightmapWritten;
+	print(fmt::format("write {}: {:.1f} ms\n", heightmapWritten ? args.Output.string() : "failed",
+		std::chrono::duration<float, std::milli>(now - writeStart).count()));
+	if (!args.Mesh.empty())
+	{
+		auto meshStart = std::chrono::steady_clock::now();
+		StockMesh mesh(simulation.GetHeights(), material);
+		bool meshWritten = mesh.Export(args.Mesh);
+		written &= meshWritten;
+		now = std::chrono::steady_clock::now();
+		print(fmt::format("mesh {}: {} triangles, {} vertices, {:.1f} ms\n", meshWritten ? args.Mesh.string() : "failed",
+			mesh.GetTriangleCount(), mesh.GetVertexCount(), std::chrono::duration<float, std::milli>(now - meshStart).count()));
+	}
+	print(fmt::format("total {:.1f} ms, {}\n", std::chrono::duration<float, std::milli>(now - start).count(),
+		simulation.HasFailures() ? "FAILED" : "OK"));
+
+	if (!args.Report.empty())
+	{
+		std::ofstream file(args.Report);
+		file << report;
+		written &= file.good();
+	}
+	if (!written)
+		return 2;
+	return simulation.HasFailures() ? 1 : 0;
+}
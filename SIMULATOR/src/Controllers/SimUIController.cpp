@@ -2,6 +2,7 @@
 #include <nfd.h>
 #include "core/ImGui/PropertyInspector.h"
 #include "core/ImGui/ScopedDisable.h"
+#include "Milling/HeightField.h"
 
 SimUIController::SimUIController(SimState& state)
 	: m_State(state)
@@ -15,6 +16,9 @@ void SimUIController::Render(ar::Ref<ar::Framebuffer> mainFB)
 	RenderMaterialConfigPanel();
 	RenderSimulationControlPanel();
 	RenderCutterConfigPanel();
+	RenderMillingErrorsPanel();
+	RenderRemovalPanel();
+	RenderJobPanel();
 	RenderErrorModal();
 }
 
@@ -24,6 +28,7 @@ void SimUIController::RenderStatsPanel()
 
 	std::string fpsText = "FPS: " + std::to_string(m_State.FPS);
 	ImGui::TextWrapped(fpsText.c_str());
+	ImGui::TextWrapped(fmt::format("Last mill: {:.2f} ms", m_State.MillTime).c_str());
 
 	ImGui::End();
 }
@@ -63,8 +68,11 @@ void SimUIController::RenderLoadPanel()
 		msg += m_State.Filepath.filename().string();
 
 	ImGui::TextWrapped(msg.c_str());
-	if (ImGui::Button("Load"))
-		OpenImportDialog();
+	{
+		ar::ScopedDisable disable(m_State.IsJobRunning || m_State.IsMillingInstant);
+		if (ImGui::Button("Load"))
+			OpenImportDialog();
+	}
 	ImGui::SameLine();
 	{
 		ar::ScopedDisable disable(m_State.Filepath.empty());
@@ -81,9 +89,35 @@ void SimUIController::RenderMaterialConfigPanel()
 	ar::PropertyInspector::InspectProperty("Divisions", m_State.Material.Samples, minVal, maxVal);
 	ar::PropertyInspector::InspectProperty("Size [cm]", m_State.Material.Size, 1, 20, 1.0f);
 	ImGui::DragFloat("Base Height [cm]", &m_State.Material.BaseHeight, 1.0f, 1, 20);
+	bool fixed = m_State.Material.Format == HeightFormat::Fixed16;
+	if (ImGui::Checkbox("16-bit heights", &fixed))
+		m_State.Material.Format = fixed ? HeightFormat::Fixed16 : HeightFormat::Float32;
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Half the memory, heights in steps of %.2f um. Applied on reset.",
+			m_State.Material.Size.y / HeightField::s_FixedMax * 1e4f);
+	ImGui::Checkbox("Sparse tiles", &m_State.Material.Sparse);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("CPU heights only keep the %ux%u tiles that were milled. Applied on reset.",
+			HeightField::s_TileSize, HeightField::s_TileSize);
 
-	if (ImGui::Button("Reset"))
-		m_State.ShouldReset = true;
+	{
+		ar::ScopedDisable disable(m_State.IsJobRunning);
+		if (ImGui::Button("Reset"))
+			m_State.ShouldReset = true;
+	}
+	{
+		ar::ScopedDisable disable(m_State.IsJobRunning || m_State.IsMillingInstant);
+		ImGui::SameLine();
+		if (ImGui::Button("Export mesh"))
+		{
+			auto path = SaveFileDialog("Mesh", "stl,obj", "stock.stl");
+			if (!path.empty())
+			{
+				m_State.MeshExportPath = path;
+				m_State.ShouldExportMesh = true;
+			}
+		}
+	}
 
 	ImGui::End();
 }
@@ -93,15 +127,73 @@ void SimUIController::RenderSimulationControlPanel()
 	ar::ScopedDisable disable(m_State.Filepath.empty());
 	
 	ImGui::Begin("Simulation");
-	ImGui::DragFloat("Speed", &m_State.SimulationSpeed, 1.0f, 1.0f, 500.0f);
 	{
-		ar::ScopedDisable disable(m_State.SimulationBegan);
+		ar::ScopedDisable disable(m_State.RealTimePlayback);
+		ImGui::DragFloat("Speed", &m_State.SimulationSpeed, 1.0f, 1.0f, 500.0f);
+	}
+	ImGui::Checkbox("Real time", &m_State.RealTimePlayback);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Play at the programmed feeds, scaled, instead of a fixed speed");
+	ImGui::SameLine();
+	{
+		ar::ScopedDisable disable(!m_State.RealTimePlayback);
+		ImGui::DragFloat("Scale", &m_State.PlaybackScale, 0.1f, 0.1f, 100.0f, "%.1fx");
+	}
+	ImGui::Checkbox("Fixed step", &m_State.FixedStep);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Advance in whole ticks, so the milled stock does not depend on the frame rate");
+	if (m_State.FixedStep)
+	{
+		const uint32_t minTicks = 1, maxTickRate = 1000, maxBatch = 1024;
+		ImGui::DragScalar("Ticks per second", ImGuiDataType_U32, &m_State.TickRate, 1.0f, &minTicks, &maxTickRate,
+			nullptr, ImGuiSliderFlags_AlwaysClamp);
+		ImGui::DragScalar("Max ticks per frame", ImGuiDataType_U32, &m_State.MaxTicksPerFrame, 1.0f, &minTicks, &maxBatch,
+			nullptr, ImGuiSliderFlags_AlwaysClamp);
+	}
+	ImGui::TextWrapped(m_State.MachiningTime < 0.0 ? "Machining time: estimating..." :
+		fmt::format("Machining time: {}", MachiningTime::Format(m_State.MachiningTime)).c_str());
+	if (ImGui::CollapsingHeader("Machine"))
+	{
+		// the program is estimated again once a value is let go, not on every drag step
+		ImGui::DragFloat("Rapid [mm/min]", &m_State.Machine.RapidFeed, 10.0f, 1.0f, 100000.0f, "%.0f");
+		bool changed = ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::DragFloat("Default feed [mm/min]", &m_State.Machine.DefaultFeed, 10.0f, 1.0f, 100000.0f, "%.0f");
+		changed |= ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::DragFloat("Acceleration [mm/s^2]", &m_State.Machine.Acceleration, 10.0f, 0.0f, 100000.0f, "%.0f");
+		changed |= ImGui::IsItemDeactivatedAfterEdit();
+		ImGui::DragFloat("Junction deviation [mm]", &m_State.Machine.JunctionDeviation, 0.001f, 0.0f, 1.0f, "%.3f");
+		changed |= ImGui::IsItemDeactivatedAfterEdit();
+		if (changed)
+			m_State.ShouldEstimateTime = true;
+	}
+	{
+		ar::ScopedDisable disable(m_State.IsSimulationRun || m_State.IsMillingInstant);
+		const char* backendNames[] = { "GPU", "CPU" };
+		int backend = static_cast<int>(m_State.Backend);
+		if (ImGui::Combo("Engine", &backend, backendNames, IM_ARRAYSIZE(backendNames)))
+		{
+			m_State.Backend = static_cast<MillingBackend>(backend);
+			if (m_State.Backend == MillingBackend::GPU)
+				m_State.Mode = MillingMode::Gather;
+			m_State.ShouldChangeEngine = true;
+		}
+		ar::ScopedDisable gpuDisable(m_State.Backend == MillingBackend::GPU);
+		const char* modeNames[] = { "Gather", "Stamp" };
+		int mode = static_cast<int>(m_State.Mode);
+		if (ImGui::Combo("Mode", &mode, modeNames, IM_ARRAYSIZE(modeNames)))
+		{
+			m_State.Mode = static_cast<MillingMode>(mode);
+			m_State.ShouldChangeEngine = true;
+		}
+	}
+	{
+		ar::ScopedDisable disable(m_State.SimulationBegan || m_State.IsMillingInstant);
 		if (ImGui::Button("Start"))
 			m_State.StartSimulation = true;
 	}
 	ImGui::SameLine();
 	{
-		ar::ScopedDisable disable(m_State.IsSimulationComplete || !m_State.SimulationBegan);
+		ar::ScopedDisable disable(m_State.IsSimulationComplete || !m_State.SimulationBegan || m_State.IsMillingInstant);
 		std::string label = m_State.IsSimulationRun ? "Pause" : "Play";
 		if (ImGui::Button(label.c_str()))
 			m_State.PlaySimulation = true;
@@ -110,8 +202,38 @@ void SimUIController::RenderSimulationControlPanel()
 			m_State.ShouldMillInstant = true;
 		
 	}
+	auto progress = fmt::format("Program read: {:.0f}%", m_State.StreamProgress * 100.0f);
+	ImGui::ProgressBar(m_State.StreamProgress, ImVec2(-1.0f, 0.0f), progress.c_str());
+	{
+		ar::ScopedDisable disable(m_State.IsMillingInstant);
+		ImGui::InputScalar("Move", ImGuiDataType_U64, &m_State.SeekMove);
+		ImGui::SameLine();
+		if (ImGui::Button("Seek"))
+			m_State.ShouldSeek = true;
+		ImGui::InputDouble("Time [s]", &m_State.SeekTime, 1.0, 60.0, "%.1f");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Into the program at the programmed feeds, as real time plays it");
+		ImGui::SameLine();
+		if (ImGui::Button("Seek##time"))
+			m_State.ShouldSeekTime = true;
+		m_State.SeekTime = std::max(m_State.SeekTime, 0.0);
+
+		// follows the cutter until it is dragged, the program is milled up to where it is let go
+		ar::ScopedDisable lengthDisable(m_State.ProgramLength <= 0.0);
+		if (!m_State.IsScrubbing)
+			m_State.ScrubPercent = m_State.PathProgress * 100.0f;
+		ImGui::SliderFloat("Progress", &m_State.ScrubPercent, 0.0f, 100.0f, "%.1f%%", ImGuiSliderFlags_AlwaysClamp);
+		m_State.IsScrubbing = ImGui::IsItemActive();
+		if (ImGui::IsItemDeactivatedAfterEdit())
+			m_State.ShouldScrub = true;
+	}
+	ImGui::DragInt("Snapshot budget [MB]", &m_State.SnapshotBudget, 1.0f, 16, 4096);
+	ImGui::TextWrapped(fmt::format("Snapshots: {} ({:.1f} MB), every {} moves", m_State.SnapshotCount,
+		m_State.SnapshotMemory / (1024.0f * 1024.0f), m_State.CurrentSnapshotInterval).c_str());
 	if (m_State.IsSimulationRun)
 		ImGui::TextWrapped("Simulation currently running...");
+	if (m_State.IsMillingInstant)
+		ImGui::TextWrapped("Milling the program...");
 	if (m_State.IsSimulationComplete)
 		ImGui::TextWrapped("Simulation complete. Load new paths to continue.");
 	ImGui::End();
@@ -123,27 +245,57 @@ void SimUIController::RenderCutterConfigPanel()
 	ImGui::Begin("Cutter");
 	if (!m_State.Filepath.empty())
 	{
+		auto& cutter = m_State.Cutter;
 		ImGui::TextWrapped("Shape: ");
 		ImGui::SameLine();
-		const char* cutterTypeNames[] = { "Flat", "Round" };
-		int currentItem = static_cast<int>(m_State.CutterType);
-		if (ImGui::Combo("##cuttertype", &currentItem, cutterTypeNames, IM_ARRAYSIZE(cutterTypeNames)))
+		const char* cutterShapeNames[] = { "Flat", "Ball", "Bull-nose", "Tapered", "V-bit" };
+		int currentItem = static_cast<int>(cutter.Shape);
+		if (ImGui::Combo("##cuttershape", &currentItem, cutterShapeNames, IM_ARRAYSIZE(cutterShapeNames)))
 		{
-			m_State.CutterType = static_cast<CutterType>(currentItem);
+			cutter.Shape = static_cast<CutterShape>(currentItem);
 		}
 
 		ImGui::TextWrapped("Diameter: ");
 		ImGui::SameLine();
-		if (ImGui::InputFloat("##diameter", &m_State.CutterSize, 1.0f, 1.0f, "%.3f [mm]"))
+		if (ImGui::InputFloat("##diameter", &cutter.Diameter, 1.0f, 1.0f, "%.3f [mm]"))
 		{
-			m_State.CutterSize = std::clamp(m_State.CutterSize, 1.0f, 24.0f);
+			cutter.Diameter = std::clamp(cutter.Diameter, 1.0f, 24.0f);
 		}
 		
 		ImGui::TextWrapped("Cutting length: ");
 		ImGui::SameLine();
-		if (ImGui::InputFloat("##cuttinglength", &m_State.CutterHeight, 1.0f, 1.0f, "%.3f [mm]"))
+		if (ImGui::InputFloat("##cuttinglength", &cutter.CuttingLength, 1.0f, 1.0f, "%.3f [mm]"))
+		{
+			cutter.CuttingLength = std::clamp(cutter.CuttingLength, 1.0f, 2 * cutter.Diameter);
+		}
+
+		if (cutter.Shape == CutterShape::BullNose)
+		{
+			ImGui::TextWrapped("Corner radius: ");
+			ImGui::SameLine();
+			if (ImGui::InputFloat("##cornerradius", &cutter.CornerRadius, 0.5f, 1.0f, "%.3f [mm]"))
+			{
+				cutter.CornerRadius = std::clamp(cutter.CornerRadius, 0.1f, cutter.Diameter / 2);
+			}
+		}
+		if (cutter.Shape == CutterShape::Tapered)
+		{
+			ImGui::TextWrapped("Tip diameter: ");
+			ImGui::SameLine();
+			if (ImGui::InputFloat("##tipdiameter", &cutter.TipDiameter, 0.5f, 1.0f, "%.3f [mm]"))
+			{
+				cutter.TipDiameter = std::clamp(cutter.TipDiameter, 0.1f, cutter.Diameter);
+			}
+		}
+		if (cutter.Shape == CutterShape::Tapered || cutter.Shape == CutterShape::VBit)
 		{
-			m_State.CutterHeight = std::clamp(m_State.CutterHeight, 1.0f, 2 * m_State.CutterSize);
+			// included angle, a tapered cutter's is twice its angle per side
+			ImGui::TextWrapped("Angle: ");
+			ImGui::SameLine();
+			if (ImGui::InputFloat("##angle", &cutter.Angle, 1.0f, 10.0f, "%.1f [deg]"))
+			{
+				cutter.Angle = std::clamp(cutter.Angle, 1.0f, 170.0f);
+			}
 		}
 	}
 	else
@@ -153,6 +305,128 @@ void SimUIController::RenderCutterConfigPanel()
 	ImGui::End();
 }
 
+void SimUIController::RenderMillingErrorsPanel()
+{
+	ImGui::Begin("Milling errors");
+	if (m_State.MillingErrors.empty())
+		ImGui::TextWrapped("No errors detected.");
+	else
+	{
+		ImGui::TextWrapped("Select an error to jump to its move.");
+		if (m_State.DroppedMillingErrors)
+			ImGui::TextWrapped(fmt::format("{} more errors were not recorded.", m_State.DroppedMillingErrors).c_str());
+
+		ar::ScopedDisable disable(m_State.IsSimulationRun || m_State.IsMillingInstant);
+		const char* kindNames[] = { "Non-cutting part contact", "Cutter drilling into base", "Down milling" };
+		if (ImGui::BeginListBox("##millingerrors", ImVec2(-1.0f, -1.0f)))
+		{
+			// long lists are clipped to the visible rows
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(m_State.MillingErrors.size()));
+			while (clipper.Step())
+				for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+				{
+					auto& error = m_State.MillingErrors[i];
+					auto label = fmt::format("Move {}: {} at texel ({}, {})##{}", error.Move,
+						kindNames[static_cast<int>(error.Kind)], error.TexelX, error.TexelY, i);
+					if (ImGui::Selectable(label.c_str(), m_State.SelectedError == static_cast<size_t>(i)))
+					{
+						m_State.SelectedError = i;
+						m_State.ShouldJumpToError = true;
+					}
+				}
+			ImGui::EndListBox();
+		}
+	}
+	ImGui::End();
+}
+
+void SimUIController::RenderRemovalPanel()
+{
+	ImGui::Begin("Material removal");
+	ImGui::TextWrapped(fmt::format("Removed: {:.3f} cm^3", m_State.RemovedVolume).c_str());
+	ImGui::TextWrapped(m_State.RemovalRate < 0.0f ? "Removal rate: -" :
+		fmt::format("Removal rate: {:.3f} cm^3/s", m_State.RemovalRate).c_str());
+	ImGui::TextWrapped(fmt::format("Air cuts: {} moves", m_State.AirCuts).c_str());
+	{
+		ar::ScopedDisable disable(m_State.Filepath.empty() || m_State.IsMillingInstant);
+		if (ImGui::Button("Export per-move table"))
+		{
+			auto path = SaveFileDialog("CSV", "csv", "removal.csv");
+			if (!path.empty())
+			{
+				m_State.RemovalExportPath = path;
+				m_State.ShouldExportRemoval = true;
+			}
+		}
+	}
+	ImGui::End();
+}
+
+void SimUIController::RenderJobPanel()
+{
+	ImGui::Begin("Job");
+	{
+		ar::ScopedDisable disable(m_State.IsJobRunning || m_State.IsMillingInstant);
+		if (ImGui::Button("Add programs"))
+			for (auto& path : OpenFilesDialog())
+				m_State.Job.push_back({ path });
+		ImGui::SameLine();
+		if (ImGui::Button("Clear"))
+			m_State.Job.clear();
+		ImGui::SameLine();
+		ar::ScopedDisable emptyDisable(m_State.Job.empty());
+		if (ImGui::Button("Run job"))
+			m_State.ShouldRunJob = true;
+	}
+	if (m_State.IsJobRunning)
+		ImGui::TextWrapped(fmt::format("Milling program {} of {}...", m_State.JobIndex + 1, m_State.Job.size()).c_str());
+	else if (m_State.JobTime > 0.0f)
+		ImGui::TextWrapped(fmt::format("Last run: {:.1f} s", m_State.JobTime / 1000.0f).c_str());
+
+	const char* statusNames[] = { "pending", "running", "done", "failed" };
+	if (ImGui::BeginTable("##job", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Program");
+		ImGui::TableSetupColumn("Cutter");
+		ImGui::TableSetupColumn("Status");
+		ImGui::TableSetupColumn("Parse [ms]");
+		ImGui::TableSetupColumn("Mill [ms]");
+		ImGui::TableSetupColumn("Errors");
+		ImGui::TableSetupColumn("Removed [cm^3]");
+		ImGui::TableSetupColumn("Machining");
+		ImGui::TableHeadersRow();
+		for (auto& program : m_State.Job)
+		{
+			bool finished = program.Status == JobStatus::Done || program.Status == JobStatus::Failed;
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(program.Filepath.filename().string().c_str());
+			if (!program.Message.empty() && ImGui::IsItemHovered())
+				ImGui::SetTooltip("%s", program.Message.c_str());
+			ImGui::TableNextColumn();
+			if (program.Cutter)
+				ImGui::TextUnformatted(program.Cutter->GetName().c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(statusNames[static_cast<int>(program.Status)]);
+			if (!finished)
+				continue;
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(fmt::format("{:.1f}", program.ParseTime).c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(fmt::format("{:.1f}", program.MillTime).c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(std::to_string(program.ErrorCount).c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(fmt::format("{:.3f}", program.RemovedVolume).c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(MachiningTime::Format(program.MachiningTime).c_str());
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
 void SimUIController::RenderErrorModal()
 {
 	const char* popupName = "Error";
@@ -186,7 +460,7 @@ void SimUIController::OpenImportDialog()
 	auto path = OpenFileDialog();
 	if (!path.empty())
 	{
-		m_State.Filepath = path;
+		m_State.ImportPath = path;
 		m_State.ShouldImport = true;
 	}
 	else
@@ -218,3 +492,55 @@ fs::path SimUIController::OpenFileDialog()
 	}
 	return fs::path(path);
 }
+
+std::vector<fs::path> SimUIController::OpenFilesDialog()
+{
+	std::vector<fs::path> paths;
+	const nfdpathset_t* outPaths;
+	nfdu8filteritem_t filters[1] = { { "G-code", "k*,f*" } };
+	nfdopendialogu8args_t args = { 0 };
+	args.filterList = filters;
+	args.filterCount = 1;
+	nfdresult_t result = NFD_OpenDialogMultipleU8_With(&outPaths, &args);
+	if (result == NFD_OKAY)
+	{
+		nfdpathsetsize_t count = 0;
+		NFD_PathSet_GetCount(outPaths, &count);
+		for (nfdpathsetsize_t i = 0; i < count; ++i)
+		{
+			nfdu8char_t* path;
+			if (NFD_PathSet_GetPathU8(outPaths, i, &path) != NFD_OKAY)
+				continue;
+			paths.emplace_back(std::string(static_cast<char*>(path)));
+			NFD_PathSet_FreePathU8(path);
+		}
+		NFD_PathSet_Free(outPaths);
+	}
+	else if (result == NFD_ERROR)
+	{
+		AR_ERROR("Error opening files: {0}", NFD_GetError());
+	}
+	return paths;
+}
+
+fs::path SimUIController::SaveFileDialog(const char* filterName, const char* extensions, const char* defaultName)
+{
+	std::string path;
+	nfdu8char_t* outPath;
+	nfdu8filteritem_t filters[1] = { { filterName, extensions } };
+	nfdsavedialogu8args_t args = { 0 };
+	args.filterList = filters;
+	args.filterCount = 1;
+	args.defaultName = defaultName;
+	nfdresult_t result = NFD_SaveDialogU8_With(&outPath, &args);
+	if (result == NFD_OKAY)
+	{
+		path = std::string(static_cast<char*>(outPath));
+		NFD_FreePathU8(outPath);
+	}
+	else if (result == NFD_ERROR)
+	{
+		AR_ERROR("Error saving file: {0}", NFD_GetError());
+	}
+	return fs::path(path);
+}
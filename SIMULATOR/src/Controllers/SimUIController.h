@@ -18,8 +18,14 @@ private:
 	void RenderMaterialConfigPanel();
 	void RenderSimulationControlPanel();
 	void RenderCutterConfigPanel();
+	void RenderMillingErrorsPanel();
+	void RenderRemovalPanel();
+	void RenderJobPanel();
 	void RenderErrorModal();
 
 	void OpenImportDialog();
 	fs::path OpenFileDialog();
+	std::vector<fs::path> OpenFilesDialog();
+	// extensions as a comma-separated list without dots
+	fs::path SaveFileDialog(const char* filterName, const char* extensions, const char* defaultName);
 };
\ No newline at end of file
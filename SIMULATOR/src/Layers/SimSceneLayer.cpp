@@ -2,9 +2,10 @@
 #include "SimEditorConstants.h"
 #include "Tools/StringTools.h"
 #include "Tools/GCodeTools.h"
+#include "Milling/StockMesh.h"
+#include "Tests/SimTests.h"
 #include "core/Utils/GeneralUtils.h"
 #include "core/Scene/DebugRenderer.h"
-#include "core/Scene/DebugRenderer.h"
 
 SimSceneLayer::SimSceneLayer(SimState& state)
 	: m_State(state),
@@ -14,6 +15,7 @@ SimSceneLayer::SimSceneLayer(SimState& state)
 		SimEditorCameraConstants::FOV, 0.5f,
 		SimEditorCameraConstants::NearPlane, SimEditorCameraConstants::FarPlane,
 		SimEditorCameraConstants::ArcballRadius)),
+	m_Stepper(m_MachineCoords, m_PathTable, m_WindowStart, [this]() { return LoadNextWindow(); }),
 	m_Block(state.Material),
 	m_HMap(state.Material, m_MachineCoords),
 	m_Timer()
@@ -30,7 +32,10 @@ void SimSceneLayer::OnAttach()
 	//Debug();p
 }
 
-void SimSceneLayer::OnDetach() { }
+void SimSceneLayer::OnDetach()
+{
+	m_EstimateStop.request_stop();
+}
 
 void SimSceneLayer::OnUpdate()
 {
@@ -46,7 +51,7 @@ void SimSceneLayer::OnUpdate()
 			m_Renderer->RenderPaths(m_PathMesh, vpMat);
 	}
 	m_Renderer->RenderMaterial(vpMat, ar::mat::ToVec4(m_Camera->GetOffset()) - m_Camera->GetPosition(),
-		m_Block, m_HMap.GetTexture());
+		m_Block, m_HMap.GetTexture(), m_HMap.GetHeightScale());
 }
 
 void SimSceneLayer::OnEvent(ar::Event& event)
@@ -69,40 +74,93 @@ void SimSceneLayer::ProcessStateChanges()
 	}
 	if (m_State.ShouldImport)
 	{
-		m_MachineCoords = GCodeTools::LoadCoords(m_State.Filepath);
-		UpdatePathMesh();
-
-		auto extension = StringTools::LeftTrim(m_State.Filepath.extension().string(), 1);
-		m_State.CutterType = GCodeTools::GetCutterType(extension);
-		m_State.CutterSize = GCodeTools::GetCutterSize(extension);
-		m_State.CutterHeight = m_State.CutterSize;
+		auto stream = std::make_unique<GCodeStream>(m_State.ImportPath);
+		std::vector<ar::mat::Vec4> window;
+		if (!stream->NextWindow(window) || window.size() < 2)
+		{
+			// keep the previous program
+			m_State.ErrorMessages.push_back("Could not load the program: " +
+				(stream->HasError() ? stream->GetError() : std::string("no moves found")));
+			m_State.ShowErrorModal = true;
+		}
+		else
+		{
+			m_State.Filepath = m_State.ImportPath;
+			LoadProgram(std::move(stream), std::move(window));
+			StartEstimate();
+		}
 		m_State.ClearImportState();
-
-		m_State.RestartSim(m_MachineCoords[0]);
+	}
+	if (m_State.ShouldEstimateTime)
+	{
+		if (!m_State.Filepath.empty() && !m_State.IsJobRunning)
+		{
+			StartEstimate();
+			// the times of the earlier windows are found again from the first one when needed
+			m_PathTable = PathTable(m_MachineCoords, m_State.Machine);
+			m_WindowTime = m_WindowStart == 0 ? 0.0 : -1.0;
+		}
+		m_State.ShouldEstimateTime = false;
+	}
+	std::erase_if(m_StoppedEstimates, [](const auto& estimate) {
+		return estimate.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		});
+	if (m_Estimate.valid() && m_Estimate.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		auto estimate = m_Estimate.get();
+		m_State.MachiningTime = estimate.GetTotal();
+		m_State.ProgramLength = estimate.CuttingLength + estimate.RapidLength;
+		UpdatePathProgress();
+	}
+	if (m_State.ShouldRunJob)
+	{
+		if (!m_State.IsJobRunning && !m_State.IsMillingInstant && !m_State.Job.empty())
+			StartJob();
+		m_State.ShouldRunJob = false;
 	}
 	if (m_State.ShouldReset)
 	{
 		m_HMap.ResetMap(m_State.Material);
-		m_State.RestartSim(m_MachineCoords[0]);
+		m_Block.UpdateMaterialDesc(m_State.Material);
+		LoadFirstWindow();
+		if (!m_MachineCoords.empty())
+		{
+			m_State.RestartSim(m_MachineCoords[0]);
+			ResetSnapshots();
+			ResetRemoval();
+		}
+		ar::DebugRenderer::Clear();
 		m_State.ShouldReset = false;
 	}
+	if (m_State.ShouldChangeEngine)
+	{
+		m_HMap.SetBackend(m_State.Backend);
+		m_HMap.SetMode(m_State.Mode);
+		m_State.ShouldChangeEngine = false;
+	}
 	if (m_State.ShouldMillInstant)
 	{
 		if (m_State.IsSimulationRun)
 		{
-			m_HMap.LoadNewPath(GetRemainingPaths());
+			m_InstantPath = GetRemainingPaths();
+			m_InstantStart = m_WindowStart + m_State.StartIndex;
 			m_State.IsSimulationRun = false;
 		}
 		else
-			m_HMap.LoadNewPath(m_MachineCoords);
-
-		auto ret = m_HMap.UpdateMap(m_State.CutterType, m_State.CutterSize / 20,
-			m_State.CutterHeight / 10, m_State.Material.BaseHeight);
-		ProcessMillingErrors(ret);
-
-		m_State.IsSimulationComplete = true;
+		{
+			LoadFirstWindow();
+			m_InstantPath = m_MachineCoords;
+			m_InstantStart = m_WindowStart;
+		}
+		m_State.IsMillingInstant = true;
 		m_State.ShouldMillInstant = false;
 	}
+	if (m_State.IsMillingInstant)
+	{
+		m_State.IsMillingInstant = MillInstantWindow();
+		if (!m_State.IsMillingInstant && m_State.IsJobRunning)
+			FinishJobProgram();
+	}
 	if (m_State.PlaySimulation)
 	{
 		if (m_State.IsSimulationRun)
@@ -113,6 +171,7 @@ void SimSceneLayer::ProcessStateChanges()
 	}
 	if (m_State.StartSimulation)
 	{
+		LoadFirstWindow();
 		m_State.StartPoint = m_MachineCoords[0];
 		m_State.StartIndex = 0;
 		m_State.IsSimulationRun = true;
@@ -120,12 +179,191 @@ void SimSceneLayer::ProcessStateChanges()
 
 		m_State.StartSimulation = false;
 	}
+	if (m_State.ShouldJumpToError)
+	{
+		if (m_State.SelectedError < m_State.MillingErrors.size() && !m_State.IsMillingInstant)
+			SeekToMove(m_State.MillingErrors[m_State.SelectedError].Move);
+		m_State.ShouldJumpToError = false;
+	}
+	if (m_State.ShouldSeek)
+	{
+		if (!m_State.IsMillingInstant && !SeekToMove(m_State.SeekMove))
+		{
+			m_State.ErrorMessages.push_back(fmt::format("Move {} is past the end of the program", m_State.SeekMove));
+			m_State.ShowErrorModal = true;
+		}
+		m_State.ShouldSeek = false;
+	}
+	if (m_State.ShouldSeekTime)
+	{
+		if (!m_State.IsMillingInstant)
+			SeekAlong(m_State.SeekTime, true);
+		m_State.ShouldSeekTime = false;
+	}
+	if (m_State.ShouldScrub)
+	{
+		if (!m_State.IsMillingInstant && m_State.ProgramLength > 0.0)
+			SeekAlong(m_State.ScrubPercent / 100.0 * m_State.ProgramLength, false);
+		m_State.ShouldScrub = false;
+	}
+	if (m_State.ShouldExportMesh)
+	{
+		HeightField heights;
+		m_HMap.ReadHeights(heights);
+		StockMesh mesh(heights, m_HMap.GetMaterial());
+		if (mesh.Export(m_State.MeshExportPath))
+			AR_INFO("Exported {0} triangles to {1}", mesh.GetTriangleCount(), m_State.MeshExportPath.string());
+		else
+		{
+			m_State.ErrorMessages.push_back("Could not write " + m_State.MeshExportPath.string());
+			m_State.ShowErrorModal = true;
+		}
+		m_State.ShouldExportMesh = false;
+	}
+	if (m_State.ShouldExportRemoval)
+	{
+		if (!m_Removal.Export(m_State.RemovalExportPath))
+		{
+			m_State.ErrorMessages.push_back("Could not write " + m_State.RemovalExportPath.string());
+			m_State.ShowErrorModal = true;
+		}
+		m_State.ShouldExportRemoval = false;
+	}
 	if (m_State.IsSimulationRun)
 	{
 		m_State.IsSimulationRun = RunSimulation();
 	}
 }
 
+void SimSceneLayer::LoadProgram(std::unique_ptr<GCodeStream> stream, std::vector<ar::mat::Vec4> window)
+{
+	m_Stream = std::move(stream);
+	m_MachineCoords = std::move(window);
+	m_WindowStart = 0;
+	m_PathTable = PathTable(m_MachineCoords, m_State.Machine);
+	m_WindowDistance = m_WindowTime = 0.0;
+	m_State.ProgramLength = 0.0;
+	m_State.StreamProgress = m_Stream->GetProgress();
+	UpdatePathMesh();
+
+	auto extension = StringTools::LeftTrim(m_State.Filepath.extension().string(), 1);
+	m_State.Cutter = GCodeTools::GetCutter(extension);
+	m_State.RestartSim(m_MachineCoords[0]);
+	// texels an earlier program stopped at are milled again
+	m_HMap.ResetStoppedTexels();
+	ResetSnapshots();
+	ResetRemoval();
+	m_ProgramMillTime = m_ProgramParseTime = 0.0f;
+	m_ProgramErrors = {};
+	ar::DebugRenderer::Clear();
+}
+
+void SimSceneLayer::StartJob()
+{
+	// a fresh stock, then every program on top of what the previous ones left
+	m_HMap.ResetMap(m_State.Material);
+	m_Block.UpdateMaterialDesc(m_State.Material);
+	for (auto& program : m_State.Job)
+		program = { program.Filepath };
+	m_State.JobIndex = 0;
+	m_State.IsJobRunning = true;
+	m_State.IsSimulationRun = false;
+	m_JobStart = std::chrono::steady_clock::now();
+	m_Prefetch.Start(m_State.Job[0].Filepath);
+	StartJobProgram();
+}
+
+void SimSceneLayer::StartJobProgram()
+{
+	auto& result = m_State.Job[m_State.JobIndex];
+	m_ProgramStart = std::chrono::steady_clock::now();
+	auto program = m_Prefetch.Take();
+	// the next program is parsed while this one is milled
+	if (m_State.JobIndex + 1 < m_State.Job.size())
+		m_Prefetch.Start(m_State.Job[m_State.JobIndex + 1].Filepath);
+
+	result.ParseTime = program.ParseTime;
+	// same check as the import dialog's filter: .k16 is a round 16 mm cutter, .f10 a flat 10 mm one
+	auto extension = StringTools::LeftTrim(result.Filepath.extension().string(), 1);
+	bool validCutter = !extension.empty() && (extension[0] == 'k' || extension[0] == 'f');
+	try
+	{
+		GCodeTools::GetCutter(extension);
+	}
+	catch (const std::exception&)
+	{
+		validCutter = false;
+	}
+	if (program.Stream->HasError() || program.FirstWindow.size() < 2 || !validCutter)
+	{
+		result.Status = JobStatus::Failed;
+		result.Message = !validCutter ? "Cutter type and size can not be read from the extension" :
+			program.Stream->HasError() ? program.Stream->GetError() : "No moves found";
+		FinishJobProgram();
+		return;
+	}
+
+	m_State.Filepath = result.Filepath;
+	LoadProgram(std::move(program.Stream), std::move(program.FirstWindow));
+	m_ProgramTime = MachiningTime(m_State.Machine);
+	m_ProgramTime.Add(m_PathTable);
+	result.Status = JobStatus::Running;
+	result.Cutter = m_State.Cutter;
+	m_State.SimulationBegan = true;
+	m_InstantPath = m_MachineCoords;
+	m_InstantStart = 0;
+	m_State.IsMillingInstant = true;
+}
+
+void SimSceneLayer::FinishJobProgram()
+{
+	auto now = std::chrono::steady_clock::now();
+	auto& result = m_State.Job[m_State.JobIndex];
+	if (result.Status == JobStatus::Running)
+	{
+		result.Points = m_WindowStart + m_MachineCoords.size();
+		result.ParseTime += m_ProgramParseTime;
+		result.MillTime = m_ProgramMillTime;
+		result.Error = m_ProgramErrors;
+		result.ErrorCount = m_State.MillingErrors.size() + m_State.DroppedMillingErrors;
+		result.RemovedVolume = m_Removal.GetTotalVolume();
+		auto& estimate = m_ProgramTime.Finish();
+		result.MachiningTime = m_State.MachiningTime = estimate.GetTotal();
+		m_State.ProgramLength = estimate.CuttingLength + estimate.RapidLength;
+		if (m_Stream->HasError())
+			result.Message = m_Stream->GetError();
+		bool failed = !result.Message.empty() || result.ErrorCount ||
+			m_ProgramErrors.NonCuttingContact || m_ProgramErrors.OverPlunge || m_ProgramErrors.DownMilling;
+		result.Status = failed ? JobStatus::Failed : JobStatus::Done;
+	}
+	result.TotalTime = std::chrono::duration<float, std::milli>(now - m_ProgramStart).count();
+	m_State.JobTime = std::chrono::duration<float, std::milli>(now - m_JobStart).count();
+
+	if (++m_State.JobIndex < m_State.Job.size())
+		StartJobProgram();
+	else
+		m_State.IsJobRunning = false;
+}
+
+void SimSceneLayer::StartEstimate()
+{
+	// a pass over the whole program, the loaded window is not enough
+	m_State.MachiningTime = -1.0;
+	m_State.ProgramLength = 0.0;
+	if (m_Estimate.valid())
+	{
+		// the previous pass is stopped and left to end on its worker
+		m_EstimateStop.request_stop();
+		m_StoppedEstimates.push_back(std::move(m_Estimate));
+	}
+	m_EstimateStop = {};
+	m_Estimate = std::async(std::launch::async, [filepath = m_State.Filepath, machine = m_State.Machine,
+		stop = m_EstimateStop.get_token()]() {
+		std::string error;
+		return MachiningTime::Estimate(filepath, machine, error, stop);
+		});
+}
+
 void SimSceneLayer::UpdatePathMesh()
 {
 	m_PathMesh->ClearBuffers();
@@ -136,51 +374,130 @@ void SimSceneLayer::UpdatePathMesh()
 bool SimSceneLayer::RunSimulation()
 {
 	// returns false when simulation is halted, true if running 
-	std::vector<ar::mat::Vec4> stops;
-	bool isRunning = true;
-	ar::mat::Vec3 start = ar::mat::ToVec3(m_State.StartPoint);
-	ar::mat::Vec3 end = ar::mat::ToVec3(m_MachineCoords[m_State.StartIndex + 1]);
-
-	stops.emplace_back(start, 1.0f);
-	auto dt = m_Timer.GetDeltaTime();
-	auto s = m_State.SimulationSpeed * dt;
-	do
-	{
-		auto d = ar::mat::Length(end - start);
-		if (s > d)
+	// path length, or machine time when playing back at the programmed feeds (acceleration is not played)
+	StepSettings settings;
+	settings.ByTime = m_State.RealTimePlayback;
+	settings.Rate = settings.ByTime ? m_State.PlaybackScale : m_State.SimulationSpeed;
+	settings.FixedStep = m_State.FixedStep;
+	settings.TickRate = m_State.TickRate;
+	settings.MaxTicksPerFrame = m_State.MaxTicksPerFrame;
+	// the ticks due are milled in one dispatch
+	CutterSteps steps;
+	bool isRunning = m_Stepper.StepFrame(m_Timer.GetDeltaTime(), settings, m_State.StartIndex, m_State.StartPoint, steps);
+	if (!isRunning)
+		m_State.IsSimulationComplete = true;
+	UpdatePathProgress();
+	if (steps.Moves.empty())
+		return isRunning;
+
+	LoadHeightmapPath(std::move(steps.Stops), std::move(steps.Moves));
+	auto ret = m_HMap.UpdateMap(m_State.Cutter, m_State.Material.BaseHeight);
+	m_State.MillTime = m_HMap.GetLastUpdateTime();
+	m_ProgramMillTime += m_State.MillTime;
+	RecordRemoval(steps.MachiningTime);
+	bool stop = ProcessMillingErrors(ret);
+	MarkRecorded(m_WindowStart + m_State.StartIndex);
+	if (stop)
+		return false;
+	if (isRunning)
+		CaptureSnapshot({ m_WindowStart + m_State.StartIndex, m_State.StartPoint, false });
+	return isRunning;
+}
+
+bool SimSceneLayer::MillInstantWindow()
+{
+	// one window per frame, so the progress stays visible on long programs
+	if (MillPath(m_InstantPath, m_InstantStart, false) && LoadNextWindow())
+	{
+		if (m_State.IsJobRunning)
+			m_ProgramTime.Add(m_PathTable);
+		m_InstantPath = m_MachineCoords;
+		m_InstantStart = m_WindowStart;
+		if (m_State.ProgramLength > 0.0)
+			m_State.PathProgress = static_cast<float>(m_WindowDistance / m_State.ProgramLength);
+		return true;
+	}
+	m_State.IsSimulationComplete = true;
+	m_State.PathProgress = 1.0f;
+	return false;
+}
+
+bool SimSceneLayer::MillPath(const std::vector<ar::mat::Vec4>& path, uint64_t firstMove, bool isReplay)
+{
+	// split where snapshots are due, so every piece ends at the start of a move, and for a replay
+	// where the recorded moves end
+	float millTime = 0.0f;
+	size_t from = 0;
+	while (from + 1 < path.size())
+	{
+		size_t to = path.size() - 1;
+		for (auto next : { m_Snapshots.GetNextMove(), isReplay ? m_RecordedMoves : UINT64_MAX })
+			if (next > firstMove + from && next < firstMove + to)
+				to = static_cast<size_t>(next - firstMove);
+
+		LoadHeightmapPath({ path.begin() + from, path.begin() + to + 1 }, firstMove + from);
+		auto ret = m_HMap.UpdateMap(m_State.Cutter, m_State.Material.BaseHeight);
+		millTime += m_HMap.GetLastUpdateTime();
+		// a replay mills moves whose errors and removal are already known, unless a seek skipped them;
+		// those are recorded like in playback, but their errors do not stop the seek
+		if (!isReplay || firstMove + from >= m_RecordedMoves)
 		{
-			s -= d;
-			stops.emplace_back(end, 1.0f);
-			m_State.StartIndex++;
-			if (m_State.StartIndex == m_MachineCoords.size() - 1)
+			RecordRemoval();
+			bool stop = ProcessMillingErrors(ret);
+			MarkRecorded(firstMove + to);
+			if (stop && !isReplay)
 			{
-				// no more segments
-				stops.emplace_back(end, 1.0f);
-				isRunning = false;
-				m_State.IsSimulationComplete = true;
-				break;
+				m_State.MillTime = millTime;
+				m_ProgramMillTime += millTime;
+				return false;
 			}
-			start = m_MachineCoords[m_State.StartIndex];
-			end = m_MachineCoords[m_State.StartIndex + 1];
 		}
-		else
+		CaptureSnapshot({ firstMove + to, path[to] });
+		from = to;
+	}
+	m_State.MillTime = millTime;
+	m_ProgramMillTime += millTime;
+	return true;
+}
+
+bool SimSceneLayer::LoadNextWindow()
+{
+	// read into the spare buffer, so the current window stays loaded at the end of the program
+	auto start = std::chrono::steady_clock::now();
+	bool read = m_Stream->NextWindow(m_NextWindow);
+	m_ProgramParseTime += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (!read)
+	{
+		if (m_Stream->HasError())
 		{
-			auto actualMove = std::min(s, d);
-			auto dir = ar::mat::Normalize(end - start);
-			auto q = start + dir * actualMove;
-			stops.emplace_back(q, 1.0f);
-			m_State.StartPoint = { q, 1.0f };
-			s = 0.0f;
-			isRunning = true;
+			m_State.ErrorMessages.push_back("Could not read the program: " + m_Stream->GetError());
+			m_State.ShowErrorModal = true;
 		}
-	} while (s > 0.0f);
-
-	m_HMap.LoadNewPath(stops);
-	auto ret = m_HMap.UpdateMap(m_State.CutterType, m_State.CutterSize / 20,
-		m_State.CutterHeight / 10, m_State.Material.BaseHeight);
-	if(ProcessMillingErrors(ret))
 		return false;
-	return isRunning;
+	}
+	std::swap(m_MachineCoords, m_NextWindow);
+	// windows share their boundary point
+	m_WindowStart += m_NextWindow.size() - 1;
+	m_WindowDistance += m_PathTable.GetLength();
+	if (m_WindowTime >= 0.0)
+		m_WindowTime += m_PathTable.GetDuration();
+	m_PathTable = PathTable(m_MachineCoords, m_State.Machine);
+	m_State.StreamProgress = m_Stream->GetProgress();
+	UpdatePathMesh();
+	return true;
+}
+
+void SimSceneLayer::LoadFirstWindow()
+{
+	if (!m_Stream || m_Stream->GetWindowIndex() == 1)
+		return;
+	m_Stream->Rewind();
+	m_Stream->NextWindow(m_MachineCoords);
+	m_WindowStart = 0;
+	m_PathTable = PathTable(m_MachineCoords, m_State.Machine);
+	m_WindowDistance = m_WindowTime = 0.0;
+	m_State.StreamProgress = m_Stream->GetProgress();
+	UpdatePathMesh();
 }
 
 std::vector<ar::mat::Vec4> SimSceneLayer::GetRemainingPaths()
@@ -189,11 +506,48 @@ std::vector<ar::mat::Vec4> SimSceneLayer::GetRemainingPaths()
 		m_MachineCoords.begin() + m_State.StartIndex,
 		m_MachineCoords.end()
 	);
+	// the cutter is already part way through the current move
+	paths[0] = m_State.StartPoint;
 	return paths;
 }
 
+void SimSceneLayer::LoadHeightmapPath(std::vector<ar::mat::Vec4> path, uint64_t firstMove)
+{
+	m_HMap.LoadNewPath(std::move(path));
+	m_PathStart = firstMove;
+	m_PathMoves.clear();
+}
+
+void SimSceneLayer::LoadHeightmapPath(std::vector<ar::mat::Vec4> path, std::vector<uint64_t> moves)
+{
+	m_HMap.LoadNewPath(std::move(path));
+	m_PathStart = moves.front();
+	m_PathMoves = std::move(moves);
+}
+
 bool SimSceneLayer::ProcessMillingErrors(MillingError err)
 {
+	// the located errors come from the same pass as the flags
+	auto& log = m_HMap.GetErrorLog();
+	for (auto& record : log.Records)
+	{
+		// a move split into several segments reports each kind once
+		uint64_t move = m_PathMoves.empty() ? m_PathStart + record.Segment : m_PathMoves[record.Segment];
+		// moves milled again after a seek back are listed already
+		if (move < m_CheckedMoves)
+			continue;
+		auto& errors = m_State.MillingErrors;
+		if (errors.empty() || errors.back().Move != move || errors.back().Kind != record.Kind)
+			errors.push_back({ move, record.Kind, record.TexelX, record.TexelY });
+	}
+	m_State.DroppedMillingErrors += log.Dropped;
+	m_ProgramErrors.NonCuttingContact |= err.NonCuttingContact;
+	m_ProgramErrors.OverPlunge |= err.OverPlunge;
+	m_ProgramErrors.DownMilling |= err.DownMilling;
+	// a job mills every program to its end, the errors go into its summary
+	if (m_State.IsJobRunning)
+		return false;
+
 	bool error = false;
 	std::string errMsg = "Simulation failed due to the following: ";
 	if (err.DownMilling)
@@ -214,6 +568,7 @@ bool SimSceneLayer::ProcessMillingErrors(MillingError err)
 
 	if (error)
 	{
+		errMsg += "\nThe offending moves are listed in the Milling errors panel.";
 		m_State.ErrorMessages.push_back(errMsg);
 		m_State.ShowErrorModal = true;
 		return true;
@@ -221,6 +576,191 @@ bool SimSceneLayer::ProcessMillingErrors(MillingError err)
 	return false;
 }
 
+bool SimSceneLayer::SeekToMove(uint64_t move)
+{
+	if (!m_Stream)
+		return false;
+	// a move past the end leaves the stock as it was, and the window where the cutter is
+	auto current = m_WindowStart + m_State.StartIndex;
+	if (!LoadWindowOf(move))
+	{
+		LoadWindowOf(current);
+		return false;
+	}
+	// the stock goes back to the newest snapshot before the move and only the rest is milled again
+	if (!m_Snapshots.IsEmpty())
+	{
+		auto from = m_Snapshots.Restore(move, m_SnapshotHeights, &m_SnapshotStopped);
+		m_HMap.LoadHeights(m_SnapshotHeights);
+		m_HMap.LoadStoppedTexels(m_SnapshotStopped);
+		ReplayTo(from, move);
+		LoadWindowOf(move);
+	}
+	// the moves from here on get milled again
+	m_Removal.Truncate(move);
+	m_RecordedMoves = std::min(m_RecordedMoves, move);
+	m_State.RemovedVolume = m_Removal.GetTotalVolume();
+	m_State.AirCuts = m_Removal.CountAirCuts();
+
+	// paused at the start of the move
+	m_State.StartIndex = static_cast<uint32_t>(move - m_WindowStart);
+	m_State.StartPoint = m_MachineCoords[m_State.StartIndex];
+	m_State.IsSimulationRun = false;
+	m_State.SimulationBegan = true;
+	m_State.IsSimulationComplete = false;
+	UpdatePathProgress();
+
+	// paths are drawn rotated into the scene, the highlight follows them
+	auto model = ar::mat::RotationMatrix({ -90.0f, 0.0f, 0.0f });
+	auto start = model * m_MachineCoords[m_State.StartIndex];
+	auto end = model * m_MachineCoords[m_State.StartIndex + 1];
+	ar::DebugRenderer::Clear();
+	ar::DebugRenderer::AddLine(ar::mat::ToVec3(start), ar::mat::ToVec3(end));
+	ar::DebugRenderer::AddPoint(ar::mat::ToVec3(start), { 1.0f, 1.0f, 0.0f });
+	return true;
+}
+
+bool SimSceneLayer::SeekAlong(double value, bool byTime)
+{
+	// value is a distance or a time into the program, a value past its end seeks to the end
+	if (!m_Stream)
+		return false;
+	if (byTime ? m_WindowTime < 0.0 || value < m_WindowTime : value < m_WindowDistance)
+		LoadFirstWindow();
+	while (value > (byTime ? m_WindowTime + m_PathTable.GetDuration() : m_WindowDistance + m_PathTable.GetLength()))
+		if (!LoadNextWindow())
+		{
+			if (m_Stream->HasError())
+				return false;
+			break;
+		}
+	value -= byTime ? m_WindowTime : m_WindowDistance;
+	auto location = byTime ? m_PathTable.AtTime(value) : m_PathTable.AtDistance(value);
+	if (!SeekToMove(m_WindowStart + location.Segment))
+		return false;
+	if (location.Offset <= 0.0f)
+		return true;
+
+	// on into the move, milled like a step of the simulation
+	auto point = m_PathTable.GetPoint(location, m_MachineCoords);
+	LoadHeightmapPath({ m_MachineCoords[m_State.StartIndex], { point, 1.0f } }, m_WindowStart + location.Segment);
+	auto ret = m_HMap.UpdateMap(m_State.Cutter, m_State.Material.BaseHeight);
+	m_State.MillTime = m_HMap.GetLastUpdateTime();
+	RecordRemoval();
+	ProcessMillingErrors(ret);
+	m_State.StartPoint = { point, 1.0f };
+	UpdatePathProgress();
+	return true;
+}
+
+bool SimSceneLayer::LoadWindowOf(uint64_t move)
+{
+	// windows are read forward only, an earlier move needs the program from its start
+	if (move < m_WindowStart)
+		LoadFirstWindow();
+	while (move + 1 >= m_WindowStart + m_MachineCoords.size())
+		if (!LoadNextWindow())
+			return false;
+	return true;
+}
+
+void SimSceneLayer::ReplayTo(SnapshotPosition from, uint64_t move)
+{
+	// mills from the snapshot up to the start of move, one window at a time
+	auto current = from.Move;
+	std::vector<ar::mat::Vec4> path{ from.Point };
+	while (current < move && LoadWindowOf(current))
+	{
+		auto last = std::min<uint64_t>(move, m_WindowStart + m_MachineCoords.size() - 1);
+		for (auto i = current + 1; i <= last; ++i)
+			path.push_back(m_MachineCoords[i - m_WindowStart]);
+		MillPath(path, current, true);
+		current = last;
+		path = { m_MachineCoords[last - m_WindowStart] };
+	}
+}
+
+void SimSceneLayer::RecordRemoval(double machiningTime)
+{
+	auto& path = m_HMap.GetPath();
+	auto& volumes = m_HMap.GetRemovedVolumes();
+	MoveRemoval pass;
+	if (m_PathMoves.empty())
+		pass = m_Removal.Add(m_PathStart, path, volumes);
+	else
+	{
+		// the segments of a move merge back into it, they lie on the same line
+		std::vector<ar::mat::Vec4> merged{ path[0] };
+		std::vector<float> mergedVolumes;
+		for (size_t i = 0; i < m_PathMoves.size() && i < volumes.size(); ++i)
+		{
+			if (i > 0 && m_PathMoves[i] == m_PathMoves[i - 1])
+			{
+				merged.back() = path[i + 1];
+				mergedVolumes.back() += volumes[i];
+			}
+			else
+			{
+				merged.push_back(path[i + 1]);
+				mergedVolumes.push_back(volumes[i]);
+			}
+		}
+		pass = m_Removal.Add(m_PathStart, merged, mergedVolumes);
+	}
+	// at the programmed feeds, a pass that was not played back has no rate
+	m_State.RemovalRate = machiningTime > 0.0 ? static_cast<float>(pass.Volume / machiningTime) : -1.0f;
+	m_State.RemovedVolume = m_Removal.GetTotalVolume();
+	m_State.AirCuts = m_Removal.CountAirCuts();
+}
+
+void SimSceneLayer::MarkRecorded(uint64_t move)
+{
+	m_RecordedMoves = std::max(m_RecordedMoves, move);
+	m_CheckedMoves = std::max(m_CheckedMoves, move);
+}
+
+void SimSceneLayer::ResetRemoval()
+{
+	m_Removal.Clear();
+	m_RecordedMoves = m_CheckedMoves = 0;
+	m_State.RemovedVolume = 0.0;
+	m_State.RemovalRate = -1.0f;
+	m_State.AirCuts = 0;
+}
+
+void SimSceneLayer::ResetSnapshots()
+{
+	m_HMap.ReadHeights(m_SnapshotHeights);
+	m_HMap.ReadStoppedTexels(m_SnapshotStopped);
+	m_Snapshots.Reset(m_SnapshotHeights, m_State.Material.Size.y - m_State.Material.BaseHeight,
+		{ m_WindowStart, m_MachineCoords[0] }, static_cast<size_t>(m_State.SnapshotBudget) << 20, m_State.SnapshotInterval,
+		&m_SnapshotStopped);
+	m_State.SnapshotCount = m_Snapshots.GetCount();
+	m_State.SnapshotMemory = m_Snapshots.GetMemoryUsage();
+	m_State.CurrentSnapshotInterval = m_Snapshots.GetInterval();
+}
+
+void SimSceneLayer::CaptureSnapshot(SnapshotPosition position)
+{
+	if (!m_Snapshots.IsDue(position.Move))
+		return;
+	m_HMap.ReadHeights(m_SnapshotHeights);
+	m_HMap.ReadStoppedTexels(m_SnapshotStopped);
+	m_Snapshots.Capture(position, m_SnapshotHeights, &m_SnapshotStopped);
+	m_State.SnapshotCount = m_Snapshots.GetCount();
+	m_State.SnapshotMemory = m_Snapshots.GetMemoryUsage();
+	m_State.CurrentSnapshotInterval = m_Snapshots.GetInterval();
+}
+
+void SimSceneLayer::UpdatePathProgress()
+{
+	if (m_State.ProgramLength <= 0.0)
+		return;
+	auto location = m_PathTable.Locate(m_State.StartIndex, ar::mat::ToVec3(m_State.StartPoint), m_MachineCoords);
+	double distance = m_WindowDistance + m_PathTable.GetDistance(location);
+	m_State.PathProgress = static_cast<float>(std::min(distance / m_State.ProgramLength, 1.0));
+}
+
 void SimSceneLayer::Debug()
 {
 	std::string testString = "123.456.78ab.cs";
@@ -229,5 +769,6 @@ void SimSceneLayer::Debug()
 		AR_TRACE("{0}", token);
 	auto trimmed = StringTools::LeftTrim(testString, 2);
 	AR_TRACE("{0}", trimmed);
+	SimTests::TestMillingSuite();
 }
 
@@ -8,6 +8,15 @@
 #include "core/CameraController.h"
 #include "Milling/MillingStock.h"
 #include "core/Timer.h"
+#include <chrono>
+#include <future>
+#include "Tools/GCodeStream.h"
+#include "Tools/ProgramPrefetch.h"
+#include "Tools/MachiningTime.h"
+#include "Tools/PathTable.h"
+#include "Tools/CutterStepper.h"
+#include "Milling/HeightmapSnapshots.h"
+#include "Milling/RemovalStats.h"
 
 class SimSceneLayer : public ar::Layer
 {
@@ -23,16 +32,64 @@ private:
 	ar::Ref<SimUIController> m_UI;
 	ar::Ref<SimRenderer> m_Renderer;
 	ar::Ref<ar::CameraController> m_Camera;
-	std::vector<ar::mat::Vec4> m_MachineCoords;
+	std::unique_ptr<GCodeStream> m_Stream;
+	std::vector<ar::mat::Vec4> m_MachineCoords;	// current window of the program
+	std::vector<ar::mat::Vec4> m_NextWindow;
+	uint64_t m_WindowStart = 0;	// program index of the window's first point
+	PathTable m_PathTable;		// of the current window
+	// along the program up to the window's first point, the time is negative while unknown
+	double m_WindowDistance = 0.0, m_WindowTime = 0.0;
+	uint64_t m_PathStart = 0;	// program index of the first move handed to the heightmap
+	std::vector<uint64_t> m_PathMoves;	// move of every segment handed to it, empty if they are consecutive
+	CutterStepper m_Stepper;	// along the current window
 	ar::Ref<ar::VertexArray> m_PathMesh;
 	MillingStock m_Block;
 	Heightmap m_HMap;
+	HeightmapSnapshots m_Snapshots;
+	RemovalStats m_Removal;
+	// moves before these have their removal recorded and their errors listed, a seek back forgets the removal after it
+	uint64_t m_RecordedMoves = 0, m_CheckedMoves = 0;
+	HeightField m_SnapshotHeights;
+	std::vector<uint32_t> m_SnapshotStopped;	// texels the heightmap stopped milling at an error
+	std::vector<ar::mat::Vec4> m_InstantPath;	// rest of the window instant milling does next
+	uint64_t m_InstantStart = 0;
 	ar::Timer m_Timer;
+	ProgramPrefetch m_Prefetch;
+	std::chrono::steady_clock::time_point m_ProgramStart, m_JobStart;
+	float m_ProgramMillTime = 0.0f, m_ProgramParseTime = 0.0f;
+	MillingError m_ProgramErrors;
+	std::future<MachiningEstimate> m_Estimate;	// of the imported program, on a worker
+	std::stop_source m_EstimateStop;
+	std::vector<std::future<MachiningEstimate>> m_StoppedEstimates;	// kept until they end, so replacing one never waits
+	MachiningTime m_ProgramTime;	// of a job program, from the windows as they are milled
 
 	void ProcessStateChanges();
+	void LoadProgram(std::unique_ptr<GCodeStream> stream, std::vector<ar::mat::Vec4> window);
+	void StartJob();
+	void StartJobProgram();
+	void FinishJobProgram();
+	void StartEstimate();
 	void UpdatePathMesh();
 	bool RunSimulation();
+	bool MillInstantWindow();
+	bool MillPath(const std::vector<ar::mat::Vec4>& path, uint64_t firstMove, bool isReplay);
+	bool LoadNextWindow();
+	void LoadFirstWindow();
 	std::vector<ar::mat::Vec4> GetRemainingPaths();
+	void LoadHeightmapPath(std::vector<ar::mat::Vec4> path, uint64_t firstMove);
+	void LoadHeightmapPath(std::vector<ar::mat::Vec4> path, std::vector<uint64_t> moves);
 	bool ProcessMillingErrors(MillingError err);
+	// machiningTime is what the pass takes at the programmed feeds, 0 if it was not played back
+	void RecordRemoval(double machiningTime = 0.0);
+	// the moves before move are milled completely, their removal recorded and their errors listed
+	void MarkRecorded(uint64_t move);
+	void ResetRemoval();
+	bool SeekToMove(uint64_t move);
+	bool SeekAlong(double value, bool byTime);
+	bool LoadWindowOf(uint64_t move);
+	void ReplayTo(SnapshotPosition from, uint64_t move);
+	void ResetSnapshots();
+	void CaptureSnapshot(SnapshotPosition position);
+	void UpdatePathProgress();
 	void Debug();
 };
\ No newline at end of file
@@ -0,0 +1,467 @@
+#include "CpuMillingEngine.h"
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <numbers>
+#include <cmath>
+#include <array>
+#include <limits>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SIM_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+#ifdef SIM_USE_SSE
+namespace
+{
+	// CpuMillingEngine::ApplySegment on four consecutive texels of a row
+	struct TexelLanes
+	{
+		const MillingParams& Params;
+		const CutterProfile& Profile;
+		__m128 Zero, One, RadiusSquared, CutterHeight, Base, ProfileScale, ProfileLast;
+
+		TexelLanes(const MillingParams& params)
+			: Params(params), Profile(*params.Profile), Zero(_mm_setzero_ps()), One(_mm_set1_ps(1.0f)),
+			RadiusSquared(_mm_set1_ps(params.CutterRadius * params.CutterRadius)),
+			CutterHeight(_mm_set1_ps(params.CutterHeight + params.ContactTolerance)),
+			Base(_mm_set1_ps(params.BaseHeight)),
+			ProfileScale(_mm_set1_ps(params.Profile->GetScale())),
+			ProfileLast(_mm_set1_ps(static_cast<float>(CutterProfile::s_Samples - 1)))
+		{ }
+
+		inline __m128 GetX(const MillingParams& params, uint32_t column) const
+		{
+			__m128i columns = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(column)), _mm_set_epi32(3, 2, 1, 0));
+			return _mm_add_ps(_mm_set1_ps(params.OffsetX), _mm_mul_ps(_mm_cvtepi32_ps(columns), _mm_set1_ps(params.TexelWidth)));
+		}
+
+		// mills the active lanes, returns the mask of lanes that hit an error
+		inline __m128 Apply(__m128& height, __m128 px, float y, const CpuMillingEngine::Segment& segment,
+			__m128 active, CpuMillingEngine::TileResult& result, double& removed) const
+		{
+			auto& s = segment.Start;
+			auto& d = segment.Dir;
+			__m128 pz = _mm_add_ps(Base, height);
+			__m128 dx = _mm_sub_ps(px, _mm_set1_ps(s.x));
+			__m128 dz = _mm_sub_ps(pz, _mm_set1_ps(s.z));
+			__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(d.x), dx), _mm_set1_ps(d.y * (y - s.y))),
+				_mm_mul_ps(_mm_set1_ps(d.z), dz));
+			t = _mm_mul_ps(t, _mm_set1_ps(segment.InvLengthSquared));
+			t = _mm_min_ps(_mm_max_ps(t, Zero), One);
+
+			__m128 ox = _mm_sub_ps(px, _mm_add_ps(_mm_set1_ps(s.x), _mm_mul_ps(t, _mm_set1_ps(d.x))));
+			__m128 oy = _mm_sub_ps(_mm_set1_ps(y), _mm_add_ps(_mm_set1_ps(s.y), _mm_mul_ps(t, _mm_set1_ps(d.y))));
+			__m128 distSquared = _mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy));
+			__m128 live = _mm_and_ps(active, _mm_cmple_ps(distSquared, RadiusSquared));
+			if (!_mm_movemask_ps(live))
+				return Zero;
+
+			__m128 bottom = _mm_add_ps(_mm_set1_ps(s.z), _mm_mul_ps(t, _mm_set1_ps(d.z)));
+			// the edge never dips below the tip, lanes the tip does not reach can not cut
+			if (!Profile.IsFlat() && _mm_movemask_ps(_mm_and_ps(live, _mm_cmplt_ps(bottom, pz))))
+				bottom = _mm_add_ps(bottom, SampleProfile(distSquared));
+			__m128 cutting = _mm_and_ps(live, _mm_cmplt_ps(bottom, pz));
+			__m128 descend = _mm_and_ps(_mm_sub_ps(pz, bottom), cutting);
+			height = _mm_sub_ps(height, descend);
+			if (_mm_movemask_ps(cutting))
+			{
+				__m128 pairs = _mm_add_ps(descend, _mm_movehl_ps(descend, descend));
+				removed += _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+			}
+
+			__m128 nc = _mm_and_ps(live, _mm_cmpgt_ps(descend, CutterHeight));
+			__m128 op = _mm_andnot_ps(nc, _mm_and_ps(live, _mm_cmple_ps(height, Zero)));
+			__m128 stop = _mm_or_ps(nc, op);
+			if (segment.IsDownMilling)
+			{
+				__m128 dm = _mm_andnot_ps(stop, _mm_and_ps(live, _mm_cmpgt_ps(descend, Zero)));
+				Report(result, _mm_movemask_ps(dm), MillingErrorKind::DownMilling, px, y, segment);
+				stop = _mm_or_ps(stop, dm);
+			}
+			Report(result, _mm_movemask_ps(nc), MillingErrorKind::NonCuttingContact, px, y, segment);
+			Report(result, _mm_movemask_ps(op), MillingErrorKind::OverPlunge, px, y, segment);
+			return stop;
+		}
+
+		// CutterProfile::Sample per lane, there is no gather before AVX2
+		inline __m128 SampleProfile(__m128 distSquared) const
+		{
+			// lanes outside the cutter are masked out by the caller, the clamp only keeps them in the table
+			__m128 s = _mm_min_ps(_mm_mul_ps(distSquared, ProfileScale), ProfileLast);
+			__m128i index = _mm_cvttps_epi32(s);
+			__m128 fraction = _mm_sub_ps(s, _mm_cvtepi32_ps(index));
+			alignas(16) int32_t i[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(i), index);
+			// both samples of a lane are adjacent, one 64-bit load fetches them
+			const float* offsets = Profile.GetOffsets().data();
+			auto pair = [offsets](__m128 v, int32_t index, bool upper) {
+				auto p = reinterpret_cast<const __m64*>(offsets + index);
+				return upper ? _mm_loadh_pi(v, p) : _mm_loadl_pi(v, p);
+			};
+			__m128 pairs01 = pair(pair(Zero, i[0], false), i[1], true);
+			__m128 pairs23 = pair(pair(Zero, i[2], false), i[3], true);
+			__m128 low = _mm_shuffle_ps(pairs01, pairs23, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 high = _mm_shuffle_ps(pairs01, pairs23, _MM_SHUFFLE(3, 1, 3, 1));
+			return _mm_add_ps(low, _mm_mul_ps(fraction, _mm_sub_ps(high, low)));
+		}
+
+		// errors are rare, the lanes are unpacked only when one happens
+		inline void Report(CpuMillingEngine::TileResult& result, int lanes, MillingErrorKind kind, __m128 px, float y,
+			const CpuMillingEngine::Segment& segment) const
+		{
+			if (!lanes)
+				return;
+			alignas(16) float xs[4];
+			_mm_store_ps(xs, px);
+			for (int lane = 0; lane < 4; ++lane)
+				if (lanes & (1 << lane))
+					result.Report(kind, segment, xs[lane], y, Params);
+		}
+	};
+}
+#endif
+
+MillingError CpuMillingEngine::Mill(HeightField& heights,
+	const std::vector<ar::mat::Vec4>& path, const MillingParams& params, MillingMode mode, TexelRect* dirtyRect,
+	MillingErrorLog* errorLog, std::vector<float>* removedVolumes, std::vector<uint32_t>* stoppedTexels)
+{
+	MillingError flags{};
+	if (dirtyRect)
+		*dirtyRect = {};
+	if (errorLog)
+		errorLog->Clear();
+	if (removedVolumes)
+		removedVolumes->assign(path.size() > 1 ? path.size() - 1 : 0, 0.0f);
+	if (path.size() < 2)
+		return flags;
+
+	uint32_t samplesX = heights.GetSamplesX(), samplesY = heights.GetSamplesY();
+	// stopped texels are kept tile by tile, a word per tile row, so parallel tiles never share a word
+	uint32_t fieldTilesX = (samplesX + s_TileSize - 1) / s_TileSize;
+	if (stoppedTexels && stoppedTexels->size() != GetStoppedWordCount(samplesX, samplesY))
+		stoppedTexels->assign(GetStoppedWordCount(samplesX, samplesY), 0);
+	SegmentBins bins;
+	bins.Build(path, samplesX, samplesY, params, s_TileSize);
+	if (bins.IsEmpty())
+		return flags;
+	if (dirtyRect)
+		*dirtyRect = bins.GetDirtyRect();
+
+	// only the tiles under the path's footprint are visited
+	auto segments = PrepareSegments(path);
+	uint32_t tilesX = bins.GetTilesX();
+	std::vector<TileResult> tileResults(bins.GetTileCount());
+	std::vector<uint32_t> tiles(bins.GetTileCount());
+	std::iota(tiles.begin(), tiles.end(), 0);
+
+	std::for_each(std::execution::par, tiles.begin(), tiles.end(), [&](uint32_t tile) {
+		auto indices = bins.GetSegments(tile);
+		if (indices.empty())
+			return;
+		// contiguous copy of the tile's segments, still in path order
+		std::vector<Segment> tileSegments;
+		tileSegments.reserve(indices.size());
+		for (auto index : indices)
+			tileSegments.push_back(segments[index]);
+		auto& result = tileResults[tile];
+		result.Removed.assign(tileSegments.size(), 0.0);
+
+		uint32_t fromX = (bins.GetOriginX() + tile % tilesX) * s_TileSize;
+		uint32_t fromY = (bins.GetOriginY() + tile / tilesX) * s_TileSize;
+		uint32_t toX = std::min(fromX + s_TileSize, samplesX), toY = std::min(fromY + s_TileSize, samplesY);
+		auto millTile = mode == MillingMode::Stamp ? StampTile : MillTile;
+		std::array<uint32_t, s_TileSize> tileStopped{};
+		uint32_t* stopped = stoppedTexels ? stoppedTexels->data() +
+			(static_cast<size_t>(fromY / s_TileSize) * fieldTilesX + fromX / s_TileSize) * s_TileSize : tileStopped.data();
+		if (heights.GetFormat() == HeightFormat::Float32 && !heights.IsSparse())
+		{
+			millTile(heights.GetFloats(), samplesX, 0, 0, fromX, toX, fromY, toY, stopped, tileSegments, params, result);
+			return;
+		}
+		// other storage is decoded into a tile of floats and written back once it is milled, a
+		// sparse tile is allocated only if that changed it
+		std::array<float, s_TileSize * s_TileSize> tileHeights;
+		heights.ReadBlock(fromX, fromY, toX - fromX, toY - fromY, tileHeights.data(), s_TileSize);
+		millTile(tileHeights.data(), s_TileSize, fromX, fromY, fromX, toX, fromY, toY,
+			stopped, tileSegments, params, result);
+		heights.WriteBlock(fromX, fromY, toX - fromX, toY - fromY, tileHeights.data(), s_TileSize);
+		});
+
+	// every texel stands for a cell of the texel spacing
+	double texelArea = static_cast<double>(params.TexelWidth) * params.TexelHeight;
+	for (uint32_t tile = 0; tile < bins.GetTileCount(); ++tile)
+	{
+		auto& result = tileResults[tile];
+		flags.NonCuttingContact |= result.Flags.NonCuttingContact;
+		flags.OverPlunge |= result.Flags.OverPlunge;
+		flags.DownMilling |= result.Flags.DownMilling;
+		if (errorLog)
+			errorLog->Records.insert(errorLog->Records.end(), result.Records.begin(), result.Records.end());
+		if (removedVolumes)
+		{
+			auto indices = bins.GetSegments(tile);
+			for (size_t i = 0; i < result.Removed.size(); ++i)
+				(*removedVolumes)[indices[i]] += static_cast<float>(result.Removed[i] * texelArea);
+		}
+	}
+	// a segment crossing several tiles may be reported by each of them
+	if (errorLog)
+		errorLog->Deduplicate();
+	return flags;
+}
+
+size_t CpuMillingEngine::GetStoppedWordCount(uint32_t samplesX, uint32_t samplesY)
+{
+	uint32_t tilesX = (samplesX + s_TileSize - 1) / s_TileSize, tilesY = (samplesY + s_TileSize - 1) / s_TileSize;
+	return static_cast<size_t>(tilesX) * tilesY * s_TileSize;
+}
+
+std::vector<CpuMillingEngine::Segment> CpuMillingEngine::PrepareSegments(const std::vector<ar::mat::Vec4>& path)
+{
+	const float downMillingLimit = -std::sin(87.0f * std::numbers::pi_v<float> / 180.0f);
+	std::vector<Segment> segments(path.size() - 1);
+	for (size_t i = 0; i + 1 < path.size(); ++i)
+	{
+		auto start = ar::mat::ToVec3(path[i]);
+		auto dir = ar::mat::ToVec3(path[i + 1]) - start;
+		float lengthSquared = ar::mat::Dot(dir, dir);
+		float length = std::sqrt(lengthSquared);
+		segments[i].Start = start;
+		segments[i].Dir = dir;
+		segments[i].InvLengthSquared = lengthSquared > 0.0f ? 1.0f / lengthSquared : 0.0f;
+		segments[i].Index = static_cast<uint32_t>(i);
+		segments[i].IsDownMilling = length >= 1e-8f && dir.z / length < downMillingLimit;
+	}
+	return segments;
+}
+
+void CpuMillingEngine::MillTile(float* heights, uint32_t stride, uint32_t originX, uint32_t originY, uint32_t fromX, uint32_t toX, uint32_t fromY, uint32_t toY,
+	uint32_t* stopped, const std::vector<Segment>& segments, const MillingParams& params, TileResult& result)
+{
+	for (uint32_t y = fromY; y < toY; ++y)
+	{
+		float* row = heights + static_cast<size_t>(y - originY) * stride;
+		uint32_t& rowStopped = stopped[y - fromY];
+		float posY = params.OffsetY + y * params.TexelHeight;
+		uint32_t x = fromX;
+#ifdef SIM_USE_SSE
+		for (; x + 4 <= toX; x += 4)
+			rowStopped |= MillTexels4(row + (x - originX), x, posY, (rowStopped >> (x - fromX)) & 0xF,
+				segments, params, result) << (x - fromX);
+#endif
+		for (; x < toX; ++x)
+			if (!((rowStopped >> (x - fromX)) & 1) &&
+				MillTexel(row[x - originX], params.OffsetX + x * params.TexelWidth, posY, segments, params, result))
+				rowStopped |= 1u << (x - fromX);
+	}
+}
+
+void CpuMillingEngine::StampTile(float* heights, uint32_t stride, uint32_t originX, uint32_t originY, uint32_t fromX, uint32_t toX, uint32_t fromY, uint32_t toY,
+	uint32_t* stopped, const std::vector<Segment>& segments, const MillingParams& params, TileResult& result)
+{
+	// texels that hit an error are left alone afterwards, like the break in the gather loop
+	float radius = params.CutterRadius;
+#ifdef SIM_USE_SSE
+	TexelLanes lanes(params);
+	const __m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+#endif
+
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		auto& segment = segments[i];
+		auto& removed = result.Removed[i];
+		float segMinY = std::min(segment.Start.y, segment.Start.y + segment.Dir.y) - radius;
+		float segMaxY = std::max(segment.Start.y, segment.Start.y + segment.Dir.y) + radius;
+		// one texel of slack on every side, the exact test is done by ApplySegment
+		auto rowFrom = static_cast<int64_t>(std::floor((segMinY - params.OffsetY) / params.TexelHeight)) - 1;
+		auto rowTo = static_cast<int64_t>(std::ceil((segMaxY - params.OffsetY) / params.TexelHeight)) + 1;
+		rowFrom = std::max<int64_t>(rowFrom, fromY);
+		rowTo = std::min<int64_t>(rowTo, static_cast<int64_t>(toY) - 1);
+
+		for (auto y = rowFrom; y <= rowTo; ++y)
+		{
+			float posY = params.OffsetY + y * params.TexelHeight;
+			float minX, maxX;
+			if (!GetCapsuleSpan(segment, posY, radius, minX, maxX))
+				continue;
+			auto colFrom = std::max<int64_t>(static_cast<int64_t>(std::floor((minX - params.OffsetX) / params.TexelWidth)) - 1, fromX);
+			auto colTo = std::min<int64_t>(static_cast<int64_t>(std::ceil((maxX - params.OffsetX) / params.TexelWidth)) + 1, static_cast<int64_t>(toX) - 1);
+
+			float* row = heights + static_cast<size_t>(y - originY) * stride;
+			uint32_t& rowStopped = stopped[y - fromY];
+			auto x = colFrom;
+#ifdef SIM_USE_SSE
+			for (; x + 3 <= colTo; x += 4)
+			{
+				auto shift = static_cast<uint32_t>(x - fromX);
+				__m128 active = _mm_castsi128_ps(_mm_cmpeq_epi32(
+					_mm_and_si128(_mm_set1_epi32(static_cast<int>(rowStopped >> shift)), laneBits), _mm_setzero_si128()));
+				if (!_mm_movemask_ps(active))
+					continue;
+				__m128 height = _mm_loadu_ps(row + (x - originX));
+				__m128 px = lanes.GetX(params, static_cast<uint32_t>(x));
+				int stop = _mm_movemask_ps(lanes.Apply(height, px, posY, segment, active, result, removed));
+				_mm_storeu_ps(row + (x - originX), height);
+				rowStopped |= static_cast<uint32_t>(stop) << shift;
+			}
+#endif
+			for (; x <= colTo; ++x)
+			{
+				auto bit = 1u << (x - fromX);
+				if (rowStopped & bit)
+					continue;
+				if (!ApplySegment(row[x - originX], params.OffsetX + x * params.TexelWidth, posY, segment, params, result, removed))
+					rowStopped |= bit;
+			}
+		}
+	}
+}
+
+bool CpuMillingEngine::GetCapsuleSpan(const Segment& segment, float y, float radius, float& minX, float& maxX)
+{
+	minX = std::numeric_limits<float>::infinity();
+	maxX = -minX;
+	auto& a = segment.Start;
+	auto& d = segment.Dir;
+
+	// end caps
+	auto addDisc = [&](float cx, float cy) {
+		float halfWidth = radius * radius - (y - cy) * (y - cy);
+		if (halfWidth < 0.0f)
+			return;
+		halfWidth = std::sqrt(halfWidth);
+		minX = std::min(minX, cx - halfWidth);
+		maxX = std::max(maxX, cx + halfWidth);
+	};
+	addDisc(a.x, a.y);
+	addDisc(a.x + d.x, a.y + d.y);
+
+	// band between the caps: 0 <= dot(d, p - a) <= |d|^2 and |cross(d, p - a)| <= r |d|
+	float lengthSquared = d.x * d.x + d.y * d.y;
+	if (lengthSquared == 0.0f)
+		return minX <= maxX;
+	float from = -std::numeric_limits<float>::infinity(), to = -from;
+	// narrows [from, to] to the x satisfying low <= k x + c <= high
+	auto clampLinear = [&](float k, float c, float low, float high) {
+		if (k == 0.0f)
+		{
+			if (c < low || c > high)
+				to = from - 1.0f;
+			return;
+		}
+		float x0 = (low - c) / k, x1 = (high - c) / k;
+		from = std::max(from, std::min(x0, x1));
+		to = std::min(to, std::max(x0, x1));
+	};
+	float halfBand = radius * std::sqrt(lengthSquared);
+	clampLinear(d.x, d.y * (y - a.y) - d.x * a.x, 0.0f, lengthSquared);
+	clampLinear(-d.y, d.x * (y - a.y) + d.y * a.x, -halfBand, halfBand);
+	if (from <= to)
+	{
+		minX = std::min(minX, from);
+		maxX = std::max(maxX, to);
+	}
+	return minX <= maxX;
+}
+
+bool CpuMillingEngine::ApplySegment(float& height, float x, float y, const Segment& segment,
+	const MillingParams& params, TileResult& result, double& removed)
+{
+	float radiusSquared = params.CutterRadius * params.CutterRadius;
+	float z = params.BaseHeight + height;
+	auto& s = segment.Start;
+	auto& d = segment.Dir;
+	float t = (d.x * (x - s.x) + d.y * (y - s.y) + d.z * (z - s.z)) * segment.InvLengthSquared;
+	t = std::clamp(t, 0.0f, 1.0f);
+	float qx = s.x + t * d.x, qy = s.y + t * d.y, qz = s.z + t * d.z;
+	float distSquared = (x - qx) * (x - qx) + (y - qy) * (y - qy);
+	if (distSquared > radiusSquared)
+		return true;
+
+	// lowest point of the cutter above this texel
+	auto& profile = *params.Profile;
+	float bottom = profile.IsFlat() || qz >= z ? qz : qz + profile.Sample(distSquared);
+	float descend = bottom < z ? z - bottom : 0.0f;
+	height -= descend;
+	removed += descend;
+
+	if (descend > params.CutterHeight + params.ContactTolerance)
+	{
+		result.Report(MillingErrorKind::NonCuttingContact, segment, x, y, params);
+		return false;
+	}
+	if (height <= 0.0f)
+	{
+		result.Report(MillingErrorKind::OverPlunge, segment, x, y, params);
+		return false;
+	}
+	if (descend > 0.0f && segment.IsDownMilling)
+	{
+		result.Report(MillingErrorKind::DownMilling, segment, x, y, params);
+		return false;
+	}
+	return true;
+}
+
+bool CpuMillingEngine::MillTexel(float& height, float x, float y,
+	const std::vector<Segment>& segments, const MillingParams& params, TileResult& result)
+{
+	for (size_t i = 0; i < segments.size(); ++i)
+		if (!ApplySegment(height, x, y, segments[i], params, result, result.Removed[i]))
+			return true;
+	return false;
+}
+
+uint32_t CpuMillingEngine::MillTexels4(float* heights, uint32_t column, float y, uint32_t stopped,
+	const std::vector<Segment>& segments, const MillingParams& params, TileResult& result)
+{
+#ifdef SIM_USE_SSE
+	if (stopped == 0xF)
+		return stopped;
+	TexelLanes lanes(params);
+	__m128 px = lanes.GetX(params, column);
+	__m128 height = _mm_loadu_ps(heights);
+	// lanes that hit an error stop processing segments, like a break in the shader
+	__m128 active = _mm_castsi128_ps(_mm_cmpeq_epi32(
+		_mm_and_si128(_mm_set1_epi32(static_cast<int>(stopped)), _mm_set_epi32(8, 4, 2, 1)), _mm_setzero_si128()));
+
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		active = _mm_andnot_ps(lanes.Apply(height, px, y, segments[i], active, result, result.Removed[i]), active);
+		if (!_mm_movemask_ps(active))
+			break;
+	}
+	_mm_storeu_ps(heights, height);
+	return static_cast<uint32_t>(_mm_movemask_ps(active)) ^ 0xF;
+#else
+	for (uint32_t lane = 0; lane < 4; ++lane)
+		if (!(stopped & (1u << lane)) &&
+			MillTexel(heights[lane], params.OffsetX + (column + lane) * params.TexelWidth, y, segments, params, result))
+			stopped |= 1u << lane;
+	return stopped;
+#endif
+}
+
+void CpuMillingEngine::TileResult::Report(MillingErrorKind kind, const Segment& segment, float x, float y,
+	const MillingParams& params)
+{
+	switch (kind)
+	{
+	case MillingErrorKind::NonCuttingContact: Flags.NonCuttingContact = 1; break;
+	case MillingErrorKind::OverPlunge: Flags.OverPlunge = 1; break;
+	case MillingErrorKind::DownMilling: Flags.DownMilling = 1; break;
+	}
+	// a tile sees few distinct segments, a linear scan keeps one record per segment and kind
+	for (auto& record : Records)
+		if (record.Segment == segment.Index && record.Kind == kind)
+			return;
+
+	MillingErrorRecord record;
+	record.Segment = segment.Index;
+	record.TexelX = static_cast<uint32_t>(std::lround((x - params.OffsetX) / params.TexelWidth));
+	record.TexelY = static_cast<uint32_t>(std::lround((y - params.OffsetY) / params.TexelHeight));
+	record.Kind = kind;
+	Records.push_back(record);
+}
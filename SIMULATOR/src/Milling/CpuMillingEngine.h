@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "ARMAT.h"
+#include "Milling/MillingParams.h"
+#include "Milling/HeightField.h"
+#include "Milling/MillingError.h"
+#include "Milling/SegmentBins.h"
+
+// CPU port of milling.comp: same per-texel walk over the path segments, same removal and error
+// checks. Tiles run in parallel over their binned segments, texels within a tile row are
+// processed four at a time.
+class CpuMillingEngine
+{
+public:
+	// heights are relative to the base like the GPU texture, fixed-point and sparse ones are
+	// milled in floats a tile at a time; texels outside dirtyRect are left untouched (empty when no segment
+	// reaches the stock); errorLog receives the located errors of this pass, found along with the
+	// flags; removedVolumes receives the material every segment cut away, in cm^3. A texel that hits
+	// an error is not milled for the rest of the call; stoppedTexels carries that across calls, so a
+	// program milled window by window ends as if it was milled in one call (clear it for the next one)
+	static MillingError Mill(HeightField& heights,
+		const std::vector<ar::mat::Vec4>& path, const MillingParams& params, MillingMode mode = MillingMode::Gather,
+		TexelRect* dirtyRect = nullptr, MillingErrorLog* errorLog = nullptr, std::vector<float>* removedVolumes = nullptr,
+		std::vector<uint32_t>* stoppedTexels = nullptr);
+	// words of the stoppedTexels mask: a word per row of every 32x32 tile, tiles row by row, bit x of
+	// a word for the texel x columns into its tile; milling.comp reads the same layout
+	static size_t GetStoppedWordCount(uint32_t samplesX, uint32_t samplesY);
+
+	// path segment prepared once per Mill call and shared by both modes
+	struct Segment
+	{
+		ar::mat::Vec3 Start, Dir;
+		float InvLengthSquared;	// 0 for degenerate segments, which project onto their start
+		uint32_t Index;			// position in the milled path, for the error records
+		bool IsDownMilling;
+	};
+
+	// flags, located errors and removal of one tile, merged once all tiles are done
+	struct TileResult
+	{
+		MillingError Flags;
+		std::vector<MillingErrorRecord> Records;
+		std::vector<double> Removed;	// summed descend of the tile's texels, per tile segment
+		void Report(MillingErrorKind kind, const Segment& segment, float x, float y, const MillingParams& params);
+	};
+
+private:
+	// one milled tile per sparse height tile, so parallel tiles never share storage
+	static constexpr uint32_t s_TileSize = HeightField::s_TileSize;
+
+	static std::vector<Segment> PrepareSegments(const std::vector<ar::mat::Vec4>& path);
+	// heights[(y - originY) * stride + x - originX] is the texel (x, y) of the stock, bit x - fromX of
+	// stopped[y - fromY] is set for texels that hit an error and are left alone
+	static void MillTile(float* heights, uint32_t stride, uint32_t originX, uint32_t originY, uint32_t fromX, uint32_t toX, uint32_t fromY, uint32_t toY,
+		uint32_t* stopped, const std::vector<Segment>& segments, const MillingParams& params, TileResult& result);
+	// scatter counterpart of MillTile: segments in order, each touching only its footprint
+	static void StampTile(float* heights, uint32_t stride, uint32_t originX, uint32_t originY, uint32_t fromX, uint32_t toX, uint32_t fromY, uint32_t toY,
+		uint32_t* stopped, const std::vector<Segment>& segments, const MillingParams& params, TileResult& result);
+	// x range of the XY capsule swept by the cutter along the segment on the row at y
+	static bool GetCapsuleSpan(const Segment& segment, float y, float radius, float& minX, float& maxX);
+	// one step of the gather loop, returns false when the texel must not be milled any further
+	static bool ApplySegment(float& height, float x, float y, const Segment& segment,
+		const MillingParams& params, TileResult& result, double& removed);
+	// return whether the texel, or the mask of the four texels, hit an error
+	static bool MillTexel(float& height, float x, float y,
+		const std::vector<Segment>& segments, const MillingParams& params, TileResult& result);
+	static uint32_t MillTexels4(float* heights, uint32_t column, float y, uint32_t stopped,
+		const std::vector<Segment>& segments, const MillingParams& params, TileResult& result);
+};
@@ -0,0 +1,51 @@
+#include "CutterDesc.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <numbers>
+#include <cmath>
+
+float CutterDesc::GetEdgeHeight(float r) const
+{
+	float radius = Diameter / 2;
+	r = std::clamp(r, 0.0f, radius);
+	float halfAngle = std::clamp(Angle, 1.0f, 179.0f) * std::numbers::pi_v<float> / 360.0f;
+	// height of a circle of radius c around (center, c) at r, the corner of a ball or bull-nose
+	auto arc = [](float c, float d) { return c - std::sqrt(std::max(c * c - d * d, 0.0f)); };
+
+	switch (Shape)
+	{
+	case CutterShape::Ball:
+		return arc(radius, r);
+	case CutterShape::BullNose:
+	{
+		float corner = std::clamp(CornerRadius, 0.0f, radius);
+		float flat = radius - corner;
+		return r <= flat ? 0.0f : arc(corner, r - flat);
+	}
+	case CutterShape::Tapered:
+	{
+		// the cone touches the tip ball where the ball's normal is perpendicular to the flank
+		float tip = std::clamp(TipDiameter / 2, 0.0f, radius);
+		float tangent = tip * std::cos(halfAngle);
+		if (r <= tangent)
+			return arc(tip, r);
+		return tip * (1.0f - std::sin(halfAngle)) + (r - tangent) / std::tan(halfAngle);
+	}
+	case CutterShape::VBit:
+		return r / std::tan(halfAngle);
+	default:
+		return 0.0f;
+	}
+}
+
+std::string CutterDesc::GetName() const
+{
+	switch (Shape)
+	{
+	case CutterShape::Ball: return fmt::format("ball {:g} mm", Diameter);
+	case CutterShape::BullNose: return fmt::format("bull-nose {:g} mm r{:g}", Diameter, CornerRadius);
+	case CutterShape::Tapered: return fmt::format("tapered {:g} mm tip {:g} {:g} deg", Diameter, TipDiameter, Angle);
+	case CutterShape::VBit: return fmt::format("V-bit {:g} mm {:g} deg", Diameter, Angle);
+	default: return fmt::format("flat {:g} mm", Diameter);
+	}
+}
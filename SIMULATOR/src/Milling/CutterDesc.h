@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+
+enum class CutterShape
+{
+	Flat,
+	Ball,
+	BullNose,	// flat bottom with rounded corners
+	Tapered,	// ball tip widening into a cone
+	VBit		// pointed cone
+};
+
+// Cutter geometry, lengths in mm like the program and its extension
+struct CutterDesc
+{
+	CutterShape Shape = CutterShape::Flat;
+	float Diameter = 1.0f;		// at the widest point of the cutting part
+	float CuttingLength = 4.0f;	// anything reaching deeper is a non-cutting contact
+	float CornerRadius = 1.0f;	// bull-nose
+	float TipDiameter = 1.0f;	// ball tip of the tapered cutter
+	float Angle = 90.0f;		// included angle of the cone in degrees, V-bit and tapered
+
+	bool operator==(const CutterDesc&) const = default;
+
+	// height of the edge above the tip at distance r from the axis, r up to half the diameter
+	float GetEdgeHeight(float r) const;
+	// e.g. "ball 16 mm", for reports and tables
+	std::string GetName() const;
+};
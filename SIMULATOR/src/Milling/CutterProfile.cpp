@@ -0,0 +1,20 @@
+#include "CutterProfile.h"
+#include <cmath>
+
+CutterProfile::CutterProfile(const CutterDesc& cutter)
+	: m_Cutter(cutter), m_Radius(cutter.Diameter / 20), m_CuttingLength(cutter.CuttingLength / 10),
+	m_Offsets(s_Samples + 1, 0.0f)
+{
+	float radiusSquared = m_Radius * m_Radius;
+	if (radiusSquared > 0.0f)
+		m_Scale = (s_Samples - 1) / radiusSquared;
+
+	// samples are spaced evenly in r^2, densest towards the rim where round edges rise fastest
+	for (uint32_t i = 0; i < s_Samples; ++i)
+	{
+		float r = std::sqrt(radiusSquared * i / (s_Samples - 1));
+		m_Offsets[i] = cutter.GetEdgeHeight(r * 10) / 10;
+		m_IsFlat = m_IsFlat && m_Offsets[i] == 0.0f;
+	}
+	m_Offsets[s_Samples] = m_Offsets[s_Samples - 1];
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Milling/CutterDesc.h"
+
+// Height of the cutter's edge above its tip, tabulated over the squared distance from the axis so
+// a lookup needs neither a sqrt nor a branch on the shape. Both milling engines and milling.comp
+// interpolate the same table, in material units (cm).
+class CutterProfile
+{
+public:
+	static constexpr uint32_t s_Samples = 4096;
+
+	CutterProfile(const CutterDesc& cutter);
+	inline const CutterDesc& GetCutter() const { return m_Cutter; }
+	inline float GetRadius() const { return m_Radius; }
+	inline float GetCuttingLength() const { return m_CuttingLength; }
+	// s_Samples offsets plus a copy of the last one, so interpolation never reads past the end
+	inline const std::vector<float>& GetOffsets() const { return m_Offsets; }
+	// maps a squared distance to a fractional table index
+	inline float GetScale() const { return m_Scale; }
+	// a flat bottom needs no lookup at all
+	inline bool IsFlat() const { return m_IsFlat; }
+
+	// distSquared must not exceed the squared radius
+	inline float Sample(float distSquared) const
+	{
+		float s = distSquared * m_Scale;
+		auto i = static_cast<uint32_t>(s);
+		return m_Offsets[i] + (s - i) * (m_Offsets[i + 1] - m_Offsets[i]);
+	}
+
+private:
+	CutterDesc m_Cutter;
+	float m_Radius, m_CuttingLength;
+	float m_Scale = 0.0f;
+	bool m_IsFlat = true;
+	std::vector<float> m_Offsets;
+};
@@ -1,7 +0,0 @@
-#pragma once
-
-enum class CutterType
-{
-	FLAT,
-	ROUND
-};
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "DeviationAnalysis.h"
+#include <fstream>
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <bit>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SIM_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+bool DesignHeightmap::Load(const std::filesystem::path& filepath)
+{
+	std::ifstream file(filepath, std::ios::binary);
+	char magic[4];
+	uint32_t version;
+	float placement[4];
+	uint32_t samples[2];
+	float heights[2];	// MinHeight, base height
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(placement), sizeof(placement));
+	file.read(reinterpret_cast<char*>(samples), sizeof(samples));
+	file.read(reinterpret_cast<char*>(heights), sizeof(heights));
+	if (!file || std::memcmp(magic, "ARHM", 4) != 0 || version != 1 || samples[0] == 0 || samples[1] == 0 ||
+		placement[2] <= 0.0f || placement[3] <= 0.0f)
+		return false;
+
+	LowerLeftCorner = { placement[0], placement[1] };
+	RealWidth = placement[2];
+	RealHeight = placement[3];
+	SamplesX = samples[0];
+	SamplesY = samples[1];
+	Heights.resize(static_cast<size_t>(SamplesX) * SamplesY);
+	file.read(reinterpret_cast<char*>(Heights.data()), Heights.size() * sizeof(float));
+	if (!file)
+		return false;
+	// the file holds the design's own z, the paths are lifted by the base height
+	for (auto& height : Heights)
+		height += heights[1];
+	return true;
+}
+
+DeviationAnalysis::DeviationAnalysis(const DesignHeightmap& design, const MaterialDesc& material)
+	: m_SamplesX(material.Samples.u), m_SamplesY(material.Samples.v), m_BaseHeight(material.BaseHeight),
+	m_Target(static_cast<size_t>(material.Samples.u) * material.Samples.v, std::numeric_limits<float>::quiet_NaN())
+{
+	if (design.Heights.size() != static_cast<size_t>(design.SamplesX) * design.SamplesY || design.Heights.empty())
+		return;
+
+	// texel (x, y) lies at (OffsetX + x * TexelWidth, OffsetY + y * TexelHeight) in path coordinates
+	float texelWidth = material.Size.x / (m_SamplesX - 1), texelHeight = material.Size.z / (m_SamplesY - 1);
+	float cellWidth = design.RealWidth / design.SamplesX, cellHeight = design.RealHeight / design.SamplesY;
+	std::vector<int> columns(m_SamplesX);
+	for (uint32_t x = 0; x < m_SamplesX; ++x)
+	{
+		float offset = -material.Size.x / 2 + x * texelWidth - design.LowerLeftCorner.x;
+		columns[x] = offset < 0.0f || offset > design.RealWidth ? -1 :
+			static_cast<int>(std::min(static_cast<uint32_t>(offset / cellWidth), design.SamplesX - 1));
+	}
+
+	std::vector<uint32_t> rows(m_SamplesY);
+	std::iota(rows.begin(), rows.end(), 0);
+	std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t y) {
+		// design rows run from the corner towards -y
+		float offset = design.LowerLeftCorner.y - (-material.Size.z / 2 + y * texelHeight);
+		if (offset < 0.0f || offset > design.RealHeight)
+			return;
+		auto row = std::min(static_cast<uint32_t>(offset / cellHeight), design.SamplesY - 1);
+		const float* source = design.Heights.data() + static_cast<size_t>(row) * design.SamplesX;
+		float* target = m_Target.data() + static_cast<size_t>(y) * m_SamplesX;
+		for (uint32_t x = 0; x < m_SamplesX; ++x)
+			if (columns[x] >= 0)
+				target[x] = source[columns[x]] - m_BaseHeight;
+		});
+}
+
+DeviationReport DeviationAnalysis::Compare(const HeightField& heights, float range, float tolerance,
+	std::vector<float>* difference) const
+{
+	DeviationReport report;
+	report.Range = range;
+	report.Histogram.assign(s_Bins, 0);
+	if (heights.GetSamplesX() != m_SamplesX || heights.GetSamplesY() != m_SamplesY || range <= 0.0f)
+		return report;
+	if (difference)
+		difference->resize(m_Target.size());
+
+	// dense Float32 rows are read in place, anything else is decoded a band at a time
+	bool direct = heights.GetFormat() == HeightFormat::Float32 && !heights.IsSparse();
+	std::vector<uint32_t> bandIndices((m_SamplesY + s_BandRows - 1) / s_BandRows);
+	std::iota(bandIndices.begin(), bandIndices.end(), 0);
+	std::vector<Band> bands(bandIndices.size());
+	std::for_each(std::execution::par, bandIndices.begin(), bandIndices.end(), [&](uint32_t index) {
+		auto& band = bands[index];
+		band.Histogram.assign(s_Bins, 0);
+		uint32_t fromY = index * s_BandRows, toY = std::min(fromY + s_BandRows, m_SamplesY);
+		std::vector<float> decoded;
+		const float* rows;
+		if (direct)
+			rows = static_cast<const float*>(heights.GetData()) + static_cast<size_t>(fromY) * m_SamplesX;
+		else
+		{
+			decoded.resize(static_cast<size_t>(toY - fromY) * m_SamplesX);
+			heights.ReadBlock(0, fromY, m_SamplesX, toY - fromY, decoded.data(), m_SamplesX);
+			rows = decoded.data();
+		}
+		for (uint32_t y = fromY; y < toY; ++y)
+		{
+			size_t offset = static_cast<size_t>(y) * m_SamplesX;
+			CompareRow(rows + static_cast<size_t>(y - fromY) * m_SamplesX, m_Target.data() + offset,
+				difference ? difference->data() + offset : nullptr, range, tolerance, band);
+		}
+		});
+
+	double sumSquares = 0.0;
+	float min = 0.0f, max = 0.0f;
+	for (auto& band : bands)
+	{
+		min = std::min(min, band.Min);
+		max = std::max(max, band.Max);
+		sumSquares += band.SumSquares;
+		report.Compared += band.Compared;
+		report.Gouged += band.Gouged;
+		for (uint32_t i = 0; i < s_Bins; ++i)
+			report.Histogram[i] += band.Histogram[i];
+	}
+	report.MaxGouge = -min;
+	report.MaxLeftover = max;
+	report.Rms = report.Compared ? static_cast<float>(std::sqrt(sumSquares / report.Compared)) : 0.0f;
+	return report;
+}
+
+void DeviationAnalysis::CompareRow(const float* heights, const float* target, float* difference,
+	float range, float tolerance, Band& band) const
+{
+	float binScale = s_Bins / (2 * range), lastBin = static_cast<float>(s_Bins - 1);
+	float sumSquares = 0.0f, min = band.Min, max = band.Max;
+	auto addBin = [&](float deviation) {
+		band.Histogram[static_cast<uint32_t>(std::clamp((deviation + range) * binScale, 0.0f, lastBin))]++;
+	};
+
+	uint32_t x = 0;
+#if SIM_USE_SSE
+	__m128 minV = _mm_set1_ps(min), maxV = _mm_set1_ps(max), sumV = _mm_setzero_ps();
+	__m128 rangeV = _mm_set1_ps(range), scaleV = _mm_set1_ps(binScale), lastV = _mm_set1_ps(lastBin);
+	__m128 gougeV = _mm_set1_ps(-tolerance), zero = _mm_setzero_ps();
+	alignas(16) int32_t bins[4];
+	for (; x + 4 <= m_SamplesX; x += 4)
+	{
+		__m128 t = _mm_loadu_ps(target + x);
+		__m128 valid = _mm_cmpord_ps(t, t);
+		int validMask = _mm_movemask_ps(valid);
+		// deviation, 0 in the lanes outside the design so they leave min, max and the sum alone
+		__m128 d = _mm_and_ps(valid, _mm_sub_ps(_mm_loadu_ps(heights + x), t));
+		if (difference)
+			_mm_storeu_ps(difference + x, d);
+		if (!validMask)
+			continue;
+		minV = _mm_min_ps(minV, d);
+		maxV = _mm_max_ps(maxV, d);
+		sumV = _mm_add_ps(sumV, _mm_mul_ps(d, d));
+		band.Compared += std::popcount(static_cast<unsigned>(validMask));
+		band.Gouged += std::popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_and_ps(valid, _mm_cmplt_ps(d, gougeV)))));
+		__m128 bin = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_add_ps(d, rangeV), scaleV), zero), lastV);
+		_mm_store_si128(reinterpret_cast<__m128i*>(bins), _mm_cvttps_epi32(bin));
+		for (int lane = 0; lane < 4; ++lane)
+			if (validMask & (1 << lane))
+				band.Histogram[bins[lane]]++;
+	}
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, minV);
+	min = std::min({ lanes[0], lanes[1], lanes[2], lanes[3] });
+	_mm_store_ps(lanes, maxV);
+	max = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+	_mm_store_ps(lanes, sumV);
+	sumSquares = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for (; x < m_SamplesX; ++x)
+	{
+		if (std::isnan(target[x]))
+		{
+			if (difference)
+				difference[x] = 0.0f;
+			continue;
+		}
+		float d = heights[x] - target[x];
+		if (difference)
+			difference[x] = d;
+		min = std::min(min, d);
+		max = std::max(max, d);
+		sumSquares += d * d;
+		band.Compared++;
+		band.Gouged += d < -tolerance;
+		addBin(d);
+	}
+	band.Min = min;
+	band.Max = max;
+	band.SumSquares += sumSquares;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "Milling/HeightField.h"
+#include "Milling/MaterialDesc.h"
+
+// Design surfaces as ar::HeightmapGenerator::Save writes them: cell (x, y) covers
+// [x, x + 1) * RealWidth / SamplesX right of the corner and [y, y + 1) * RealHeight / SamplesY below it,
+// heights are absolute in cm like the paths
+struct DesignHeightmap
+{
+	ar::mat::Vec2 LowerLeftCorner = { -7.5f, 7.5f };
+	float RealWidth = 15.0f, RealHeight = 15.0f;
+	uint32_t SamplesX = 0, SamplesY = 0;
+	std::vector<float> Heights;
+
+	// false if the file is not a version 1 design heightmap
+	bool Load(const std::filesystem::path& filepath);
+};
+
+struct DeviationReport
+{
+	float MaxGouge = 0.0f;		// deepest cut below the design in cm, 0 if there is none
+	float MaxLeftover = 0.0f;	// most material left above it
+	float Rms = 0.0f;
+	size_t Compared = 0;		// texels over the design
+	size_t Gouged = 0;			// texels cut deeper than the tolerance
+	float Range = 0.0f;			// the histogram spans [-Range, Range]
+	// bins of equal width from -Range up, deviations past either end are counted in the end bins
+	std::vector<uint64_t> Histogram;
+};
+
+// Signed vertical distance from the design to the milled stock at every texel: positive where
+// material is left over, negative where the part is gouged. The design is resampled onto the stock's
+// texels once (the cell a texel lies in, as HeightmapGenerator::MapPoint picks it), so generate it at
+// least at the stock's resolution; texels outside the design are not compared. Comparing runs over row
+// bands in parallel, four texels at a time with SSE, and costs a few ms for a 1500 x 1500 stock.
+class DeviationAnalysis
+{
+public:
+	static constexpr uint32_t s_Bins = 40;
+
+	DeviationAnalysis(const DesignHeightmap& design, const MaterialDesc& material);
+
+	// difference, if given, receives the signed deviation of every texel, 0 outside the design
+	DeviationReport Compare(const HeightField& heights, float range, float tolerance,
+		std::vector<float>* difference = nullptr) const;
+	inline uint32_t GetSamplesX() const { return m_SamplesX; }
+	inline uint32_t GetSamplesY() const { return m_SamplesY; }
+
+private:
+	static constexpr uint32_t s_BandRows = 16;
+
+	struct Band
+	{
+		float Min = 0.0f, Max = 0.0f;
+		double SumSquares = 0.0;
+		size_t Compared = 0, Gouged = 0;
+		std::vector<uint64_t> Histogram;
+	};
+
+	void CompareRow(const float* heights, const float* target, float* difference, float range, float tolerance, Band& band) const;
+
+	uint32_t m_SamplesX, m_SamplesY;
+	float m_BaseHeight;
+	// design height under every texel relative to the base, NaN outside the design
+	std::vector<float> m_Target;
+};
@@ -0,0 +1,212 @@
+#include "HeightField.h"
+#include <cstring>
+
+HeightField::HeightField(const MaterialDesc& material)
+	: m_Format(material.Format), m_Sparse(material.Sparse), m_SamplesX(material.Samples.u), m_SamplesY(material.Samples.v),
+	m_TilesX((material.Samples.u + s_TileSize - 1) / s_TileSize), m_TilesY((material.Samples.v + s_TileSize - 1) / s_TileSize),
+	m_Scale(material.Size.y / s_FixedMax), m_InvScale(s_FixedMax / material.Size.y)
+{
+	if (m_Sparse)
+	{
+		m_Tiles.resize(static_cast<size_t>(m_TilesX) * m_TilesY);
+		m_Allocated.resize(m_Tiles.size());
+	}
+	else if (m_Format == HeightFormat::Float32)
+		m_Floats.resize(GetCount());
+	else
+		m_Fixed.resize(GetCount());
+	Fill(material.Size.y - material.BaseHeight);
+}
+
+void HeightField::Fill(float height)
+{
+	m_FillFixed = Encode(height);
+	m_Fill = m_Format == HeightFormat::Float32 ? height : m_FillFixed * m_Scale;
+	if (m_Sparse)
+	{
+		// untouched tiles own no memory, so only the ones written since the last fill are freed
+		for (uint32_t i = 0; i < m_AllocatedCount; ++i)
+			m_Tiles[m_Allocated[i]] = {};
+		m_AllocatedCount = 0;
+	}
+	else if (m_Format == HeightFormat::Float32)
+		std::fill(m_Floats.begin(), m_Floats.end(), height);
+	else
+		std::fill(m_Fixed.begin(), m_Fixed.end(), m_FillFixed);
+}
+
+float HeightField::GetSparse(size_t i) const
+{
+	uint32_t inTile;
+	auto& tile = m_Tiles[GetTile(i, inTile)];
+	if (tile.empty())
+		return m_Fill;
+	if (m_Format == HeightFormat::Fixed16)
+		return tile[inTile] * m_Scale;
+	float height;
+	std::memcpy(&height, tile.data() + 2 * inTile, sizeof(float));
+	return height;
+}
+
+void HeightField::SetSparse(size_t i, float height)
+{
+	uint32_t inTile;
+	size_t index = GetTile(i, inTile);
+	auto& tile = m_Tiles[index];
+	if (m_Format == HeightFormat::Fixed16)
+	{
+		uint16_t value = Encode(height);
+		if (tile.empty() && value == m_FillFixed)
+			return;
+		AllocateTile(index);
+		tile[inTile] = value;
+		return;
+	}
+	if (tile.empty() && height == m_Fill)
+		return;
+	AllocateTile(index);
+	std::memcpy(tile.data() + 2 * inTile, &height, sizeof(float));
+}
+
+void HeightField::AllocateTile(size_t tile)
+{
+	if (!m_Tiles[tile].empty())
+		return;
+	auto words = GetTexelWords(m_Fill);
+	m_Tiles[tile].resize(s_TileTexels * words.size());
+	for (size_t i = 0; i < m_Tiles[tile].size(); ++i)
+		m_Tiles[tile][i] = words[i % words.size()];
+	// blocks of different tiles are written in parallel, each allocation takes its own slot
+	auto slot = std::atomic_ref(m_AllocatedCount).fetch_add(1, std::memory_order_relaxed);
+	m_Allocated[slot] = static_cast<uint32_t>(tile);
+}
+
+void HeightField::ReadBlock(uint32_t x, uint32_t y, uint32_t w, uint32_t h, float* out, uint32_t stride) const
+{
+	if (!m_Sparse)
+	{
+		for (uint32_t row = 0; row < h; ++row)
+		{
+			size_t from = static_cast<size_t>(y + row) * m_SamplesX + x;
+			for (uint32_t i = 0; i < w; ++i)
+				out[row * stride + i] = Get(from + i);
+		}
+		return;
+	}
+	// row by row, one run per tile the row crosses
+	for (uint32_t row = 0; row < h; ++row)
+	{
+		uint32_t ty = (y + row) / s_TileSize, tileRow = (y + row) % s_TileSize;
+		for (uint32_t i = 0; i < w;)
+		{
+			uint32_t tileColumn = (x + i) % s_TileSize, count = std::min(w - i, s_TileSize - tileColumn);
+			auto& tile = m_Tiles[static_cast<size_t>(ty) * m_TilesX + (x + i) / s_TileSize];
+			uint32_t inTile = tileRow * s_TileSize + tileColumn;
+			float* to = out + static_cast<size_t>(row) * stride + i;
+			if (tile.empty())
+				std::fill(to, to + count, m_Fill);
+			else if (m_Format == HeightFormat::Float32)
+				std::memcpy(to, tile.data() + 2 * inTile, count * sizeof(float));
+			else
+				for (uint32_t j = 0; j < count; ++j)
+					to[j] = tile[inTile + j] * m_Scale;
+			i += count;
+		}
+	}
+}
+
+void HeightField::WriteBlock(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const float* in, uint32_t stride)
+{
+	for (uint32_t row = 0; row < h; ++row)
+	{
+		size_t from = static_cast<size_t>(y + row) * m_SamplesX + x;
+		for (uint32_t i = 0; i < w; ++i)
+			Set(from + i, in[row * stride + i]);
+	}
+}
+
+void HeightField::ToFloats(std::vector<float>& heights) const
+{
+	if (m_Format == HeightFormat::Float32 && !m_Sparse)
+	{
+		heights = m_Floats;
+		return;
+	}
+	heights.resize(GetCount());
+	ReadBlock(0, 0, m_SamplesX, m_SamplesY, heights.data(), m_SamplesX);
+}
+
+void HeightField::LoadData(const void* data)
+{
+	if (!m_Sparse)
+	{
+		std::memcpy(GetData(), data, GetByteSize());
+		return;
+	}
+	Fill(m_Fill);
+	auto texels = static_cast<const uint8_t*>(data);
+	size_t texelBytes = GetTexelBytes();
+	auto fill = GetTexelWords(m_Fill);
+	for (size_t tile = 0; tile < m_Tiles.size(); ++tile)
+	{
+		auto rect = GetChunkRect(tile);
+		for (uint32_t y = rect.MinY; y < rect.MaxY; ++y)
+		{
+			auto from = texels + (static_cast<size_t>(y) * m_SamplesX + rect.MinX) * texelBytes;
+			size_t bytes = rect.GetWidth() * texelBytes;
+			if (m_Tiles[tile].empty())
+			{
+				bool changed = false;
+				for (size_t i = 0; i < rect.GetWidth() && !changed; ++i)
+					changed = std::memcmp(from + i * texelBytes, fill.data(), texelBytes) != 0;
+				if (!changed)
+					continue;
+				AllocateTile(tile);
+			}
+			auto to = reinterpret_cast<uint8_t*>(m_Tiles[tile].data()) + (y - rect.MinY) * s_TileSize * texelBytes;
+			std::memcpy(to, from, bytes);
+		}
+	}
+}
+
+size_t HeightField::GetMemoryUsage() const
+{
+	if (!m_Sparse)
+		return GetByteSize();
+	size_t bytes = m_Tiles.size() * sizeof(m_Tiles[0]) + m_Allocated.size() * sizeof(m_Allocated[0]);
+	for (uint32_t i = 0; i < m_AllocatedCount; ++i)
+		bytes += m_Tiles[m_Allocated[i]].size() * sizeof(uint16_t);
+	return bytes;
+}
+
+const uint16_t* HeightField::GetChunk(size_t chunk) const
+{
+	if (!m_Sparse)
+		return static_cast<const uint16_t*>(GetData());
+	return m_Tiles[chunk].empty() ? nullptr : m_Tiles[chunk].data();
+}
+
+uint16_t* HeightField::EditChunk(size_t chunk)
+{
+	if (!m_Sparse)
+		return static_cast<uint16_t*>(GetData());
+	AllocateTile(chunk);
+	return m_Tiles[chunk].data();
+}
+
+TexelRect HeightField::GetChunkRect(size_t chunk) const
+{
+	if (!m_Sparse)
+		return { 0, 0, m_SamplesX, m_SamplesY };
+	auto x = static_cast<uint32_t>(chunk % m_TilesX) * s_TileSize, y = static_cast<uint32_t>(chunk / m_TilesX) * s_TileSize;
+	return { x, y, std::min(x + s_TileSize, m_SamplesX), std::min(y + s_TileSize, m_SamplesY) };
+}
+
+std::vector<uint16_t> HeightField::GetTexelWords(float height) const
+{
+	if (m_Format == HeightFormat::Fixed16)
+		return { Encode(height) };
+	std::vector<uint16_t> words(sizeof(float) / sizeof(uint16_t));
+	std::memcpy(words.data(), &height, sizeof(float));
+	return words;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include "Milling/MaterialDesc.h"
+#include "Milling/SegmentBins.h"
+
+// Row-major heights of the stock above its base, in cm, stored as floats or in 16-bit fixed point.
+// Fixed16 keeps every height as a multiple of Size.y / 65535 (0.76 um for a 5 cm stock, 1.5 um
+// for 10 cm), rounded to the nearest step: a stored height is within half a step of the milled
+// one, each milling pass over a texel adds at most another half step, and anything below the
+// base is stored as 0. That is well under what a 1500 or 8k sample grid resolves sideways, for
+// half the memory and bandwidth of Float32. A height rounded up makes the next descend over the
+// texel up to half a step deeper, so the non-cutting contact check allows for GetPrecision
+// (MillingParams::ContactTolerance) and a cut exactly as deep as the cutting length passes in
+// both formats.
+// A sparse field splits the stock into s_TileSize square tiles that hold the fill height until a
+// write first changes one of their texels, so its memory follows the machined area and a Fill
+// only frees the tiles touched since the last one.
+class HeightField
+{
+public:
+	static constexpr float s_FixedMax = 65535.0f;
+	static constexpr uint32_t s_TileSize = 32;
+	static constexpr uint32_t s_TileTexels = s_TileSize * s_TileSize;
+
+	HeightField() = default;
+	// filled with the untouched stock
+	HeightField(const MaterialDesc& material);
+
+	inline HeightFormat GetFormat() const { return m_Format; }
+	inline bool IsSparse() const { return m_Sparse; }
+	inline uint32_t GetSamplesX() const { return m_SamplesX; }
+	inline uint32_t GetSamplesY() const { return m_SamplesY; }
+	inline size_t GetCount() const { return static_cast<size_t>(m_SamplesX) * m_SamplesY; }
+	// cm per stored unit, 1 for Float32; also what the GPU multiplies the normalized R16 texel by
+	inline float GetScale() const { return m_Format == HeightFormat::Fixed16 ? m_Scale * s_FixedMax : 1.0f; }
+	// largest rounding error of a single store, 0 for Float32
+	inline float GetPrecision() const { return m_Format == HeightFormat::Fixed16 ? m_Scale / 2 : 0.0f; }
+	static inline float GetPrecision(const MaterialDesc& material)
+	{
+		return material.Format == HeightFormat::Fixed16 ? material.Size.y / s_FixedMax / 2 : 0.0f;
+	}
+	// height of every texel not written since the last Fill, as it reads back
+	inline float GetFill() const { return m_Fill; }
+
+	inline float Get(size_t i) const
+	{
+		if (m_Sparse)
+			return GetSparse(i);
+		return m_Format == HeightFormat::Float32 ? m_Floats[i] : m_Fixed[i] * m_Scale;
+	}
+	inline void Set(size_t i, float height)
+	{
+		if (m_Sparse)
+			SetSparse(i, height);
+		else if (m_Format == HeightFormat::Float32)
+			m_Floats[i] = height;
+		else
+			m_Fixed[i] = Encode(height);
+	}
+	void Fill(float height);
+	// dense Float32 storage, milled in place
+	inline float* GetFloats() { return m_Floats.data(); }
+	// decodes the w x h block at (x, y) into out, whose rows are stride floats apart; writes to
+	// different tiles of a sparse field may run in parallel
+	void ReadBlock(uint32_t x, uint32_t y, uint32_t w, uint32_t h, float* out, uint32_t stride) const;
+	void WriteBlock(uint32_t x, uint32_t y, uint32_t w, uint32_t h, const float* in, uint32_t stride);
+	void ToFloats(std::vector<float>& heights) const;
+
+	// storage as it is uploaded to the texture, dense fields only
+	inline const void* GetData() const { return m_Format == HeightFormat::Float32 ? static_cast<const void*>(m_Floats.data()) : m_Fixed.data(); }
+	inline void* GetData() { return m_Format == HeightFormat::Float32 ? static_cast<void*>(m_Floats.data()) : m_Fixed.data(); }
+	inline size_t GetByteSize() const { return GetCount() * GetTexelBytes(); }
+	inline size_t GetTexelBytes() const { return m_Format == HeightFormat::Float32 ? sizeof(float) : sizeof(uint16_t); }
+	// copies a whole image in the storage format, a sparse field keeps only the tiles that differ from the fill
+	void LoadData(const void* data);
+	// bytes held by the heights
+	size_t GetMemoryUsage() const;
+
+	// The storage seen as chunks of 16-bit words, two per texel for Float32: a dense field is one
+	// chunk, a sparse one has a chunk per tile with its rows s_TileSize texels apart
+	inline size_t GetChunkCount() const { return m_Sparse ? m_Tiles.size() : 1; }
+	inline size_t GetChunkWordCount() const { return (m_Sparse ? s_TileTexels : GetCount()) * GetTexelBytes() / sizeof(uint16_t); }
+	// null for a tile that still holds the fill height
+	const uint16_t* GetChunk(size_t chunk) const;
+	// allocates the tile if needed
+	uint16_t* EditChunk(size_t chunk);
+	// texels a chunk covers
+	TexelRect GetChunkRect(size_t chunk) const;
+	// words of a single texel holding height
+	std::vector<uint16_t> GetTexelWords(float height) const;
+
+private:
+	inline uint16_t Encode(float height) const
+	{
+		return static_cast<uint16_t>(std::clamp(height * m_InvScale + 0.5f, 0.0f, s_FixedMax));
+	}
+	// tile holding texel i and the texel's index within it
+	inline size_t GetTile(size_t i, uint32_t& inTile) const
+	{
+		auto x = static_cast<uint32_t>(i % m_SamplesX), y = static_cast<uint32_t>(i / m_SamplesX);
+		inTile = (y % s_TileSize) * s_TileSize + x % s_TileSize;
+		return static_cast<size_t>(y / s_TileSize) * m_TilesX + x / s_TileSize;
+	}
+	float GetSparse(size_t i) const;
+	void SetSparse(size_t i, float height);
+	void AllocateTile(size_t tile);
+
+	HeightFormat m_Format = HeightFormat::Float32;
+	bool m_Sparse = false;
+	uint32_t m_SamplesX = 0, m_SamplesY = 0;
+	uint32_t m_TilesX = 0, m_TilesY = 0;
+	float m_Scale = 1.0f, m_InvScale = 1.0f;	// cm per fixed-point unit and back
+	float m_Fill = 0.0f;
+	uint16_t m_FillFixed = 0;
+	std::vector<float> m_Floats;
+	std::vector<uint16_t> m_Fixed;
+	// sparse storage, one entry per tile in the field's format, empty until first changed
+	std::vector<std::vector<uint16_t>> m_Tiles;
+	// the first m_AllocatedCount entries are the tiles allocated since the last Fill, in no order
+	std::vector<uint32_t> m_Allocated;
+	alignas(std::atomic_ref<uint32_t>::required_alignment) uint32_t m_AllocatedCount = 0;
+};
@@ -0,0 +1,238 @@
+#include "HeightmapSnapshots.h"
+#include <algorithm>
+#include <cstring>
+
+void HeightmapSnapshots::Reset(const HeightField& heights, float initialHeight, SnapshotPosition start,
+	size_t budget, uint64_t interval, const std::vector<uint32_t>* stopped)
+{
+	m_Snapshots.clear();
+	m_DeltaBytes = 0;
+	m_StoppedWords = stopped ? stopped->size() : 0;
+	m_Budget = budget;
+	m_Interval = std::max<uint64_t>(interval, 1);
+	m_InitialHeight = initialHeight;
+	// the first delta is taken against a flat stock, so a fresh one costs nothing
+	m_Latest = heights;
+	m_Latest.Fill(initialHeight);
+
+	Snapshot snapshot{ start };
+	EncodeDelta(heights, &m_Latest, snapshot.Delta);
+	PackStopped(stopped, snapshot.Stopped);
+	m_DeltaBytes += snapshot.GetBytes();
+	m_Snapshots.push_back(std::move(snapshot));
+	m_Latest = heights;
+}
+
+void HeightmapSnapshots::Capture(SnapshotPosition position, const HeightField& heights, const std::vector<uint32_t>* stopped)
+{
+	// a replay after a seek passes positions that are already covered
+	if (m_Snapshots.empty() || position.Move <= m_Snapshots.back().Position.Move ||
+		heights.GetChunkCount() != m_Latest.GetChunkCount() || heights.GetChunkWordCount() != m_Latest.GetChunkWordCount())
+		return;
+
+	Snapshot snapshot{ position };
+	EncodeDelta(heights, &m_Latest, snapshot.Delta);
+	PackStopped(stopped, snapshot.Stopped);
+	m_DeltaBytes += snapshot.GetBytes();
+	m_Snapshots.push_back(std::move(snapshot));
+	m_Latest = heights;
+
+	while (m_DeltaBytes > m_Budget && m_Snapshots.size() > 2)
+		Thin();
+}
+
+SnapshotPosition HeightmapSnapshots::Restore(uint64_t move, HeightField& heights, std::vector<uint32_t>* stopped) const
+{
+	// the first snapshot always qualifies, seeks start at or after it
+	size_t target = 0;
+	for (size_t i = 1; i < m_Snapshots.size() && m_Snapshots[i].Position.IsBefore(move); ++i)
+		target = i;
+
+	size_t forward = 0, backward = 0;
+	for (size_t i = 0; i < m_Snapshots.size(); ++i)
+		(i <= target ? forward : backward) += m_Snapshots[i].Delta.size();
+
+	heights = m_Latest;
+	if (forward <= backward)
+	{
+		heights.Fill(m_InitialHeight);
+		for (size_t i = 0; i <= target; ++i)
+			Apply(m_Snapshots[i].Delta, heights);
+	}
+	else
+	{
+		// XOR deltas undo themselves
+		for (size_t i = m_Snapshots.size() - 1; i > target; --i)
+			Apply(m_Snapshots[i].Delta, heights);
+	}
+	if (stopped)
+	{
+		auto& packed = m_Snapshots[target].Stopped;
+		stopped->assign(m_StoppedWords, 0);
+		for (size_t i = 0; i + 1 < packed.size(); i += 2)
+			(*stopped)[packed[i]] = packed[i + 1];
+	}
+	return m_Snapshots[target].Position;
+}
+
+void HeightmapSnapshots::Thin()
+{
+	// keeps the first and the newest snapshot, the deltas of dropped ones move into their successors
+	std::vector<Snapshot> kept;
+	kept.push_back(std::move(m_Snapshots[0]));
+	m_DeltaBytes = kept.back().GetBytes();
+	HeightField merged = m_Latest;
+	for (size_t i = 1; i < m_Snapshots.size(); ++i)
+	{
+		if (i % 2 == 1 && i + 1 < m_Snapshots.size())
+		{
+			// both deltas XORed into a field of zero words
+			merged.Fill(0.0f);
+			Apply(m_Snapshots[i].Delta, merged);
+			Apply(m_Snapshots[i + 1].Delta, merged);
+			EncodeDelta(merged, nullptr, m_Snapshots[i + 1].Delta);
+			continue;
+		}
+		m_DeltaBytes += m_Snapshots[i].GetBytes();
+		kept.push_back(std::move(m_Snapshots[i]));
+	}
+	m_Snapshots = std::move(kept);
+	m_Interval *= 2;
+}
+
+void HeightmapSnapshots::PackStopped(const std::vector<uint32_t>* stopped, std::vector<uint32_t>& packed) const
+{
+	// the mask is whole in every snapshot, errors are rare enough that deltas would not pay off
+	packed.clear();
+	if (!stopped || stopped->size() != m_StoppedWords)
+		return;
+	for (size_t i = 0; i < stopped->size(); ++i)
+		if ((*stopped)[i])
+			packed.insert(packed.end(), { static_cast<uint32_t>(i), (*stopped)[i] });
+}
+
+void HeightmapSnapshots::EncodeDelta(const HeightField& heights, const HeightField* previous, std::vector<uint8_t>& delta)
+{
+	DeltaWriter writer(delta);
+	size_t words = heights.GetChunkWordCount();
+	if (previous)
+		m_Diff.resize(words);
+	for (size_t chunk = 0; chunk < heights.GetChunkCount(); ++chunk)
+	{
+		// tiles neither side ever changed hold the same fill
+		float fill = previous ? previous->GetFill() : 0.0f;
+		if (!heights.GetChunk(chunk) && (!previous || !previous->GetChunk(chunk)) && heights.GetFill() == fill)
+		{
+			writer.Skip(words);
+			continue;
+		}
+		auto current = GetChunkWords(heights, chunk, m_Current);
+		if (!previous)
+		{
+			writer.Write(current, words);
+			continue;
+		}
+		auto last = GetChunkWords(*previous, chunk, m_Previous);
+		for (size_t i = 0; i < words; ++i)
+			m_Diff[i] = current[i] ^ last[i];
+		writer.Write(m_Diff.data(), words);
+	}
+	writer.Finish();
+}
+
+const uint16_t* HeightmapSnapshots::GetChunkWords(const HeightField& heights, size_t chunk, std::vector<uint16_t>& buffer)
+{
+	if (auto words = heights.GetChunk(chunk))
+		return words;
+	auto fill = heights.GetTexelWords(heights.GetFill());
+	buffer.resize(heights.GetChunkWordCount());
+	for (size_t i = 0; i < buffer.size(); ++i)
+		buffer[i] = fill[i % fill.size()];
+	return buffer.data();
+}
+
+void HeightmapSnapshots::DeltaWriter::Write(const uint16_t* diff, size_t count)
+{
+	size_t i = 0;
+	while (i < count)
+	{
+		size_t unchanged = i;
+		while (unchanged < count && diff[unchanged] == 0)
+			unchanged++;
+		if (unchanged > i)
+			Skip(unchanged - i);
+		size_t changed = unchanged;
+		while (changed < count && diff[changed] != 0)
+			changed++;
+		m_Changed.insert(m_Changed.end(), diff + unchanged, diff + changed);
+		i = changed;
+	}
+}
+
+void HeightmapSnapshots::DeltaWriter::Flush()
+{
+	if (m_Changed.empty())
+		return;
+	WriteVarint(m_Delta, m_Unchanged);
+	WriteVarint(m_Delta, m_Changed.size());
+	auto bytes = reinterpret_cast<const uint8_t*>(m_Changed.data());
+	m_Delta.insert(m_Delta.end(), bytes, bytes + m_Changed.size() * sizeof(uint16_t));
+	m_Unchanged = 0;
+	m_Changed.clear();
+}
+
+void HeightmapSnapshots::DeltaWriter::Finish()
+{
+	Flush();
+	m_Delta.shrink_to_fit();
+}
+
+void HeightmapSnapshots::Apply(const std::vector<uint8_t>& delta, HeightField& heights)
+{
+	size_t chunkWords = heights.GetChunkWordCount();
+	size_t position = 0, chunkStart = 0, chunkEnd = 0;
+	uint16_t* words = nullptr;
+	const uint8_t* in = delta.data();
+	const uint8_t* end = in + delta.size();
+	while (in < end)
+	{
+		position += ReadVarint(in);
+		auto count = ReadVarint(in);
+		for (uint64_t i = 0; i < count; ++i, ++position, in += sizeof(uint16_t))
+		{
+			// runs only move forward, so the chunk changes once they cross its end
+			if (position >= chunkEnd)
+			{
+				size_t chunk = position / chunkWords;
+				chunkStart = chunk * chunkWords;
+				chunkEnd = chunkStart + chunkWords;
+				words = heights.EditChunk(chunk);
+			}
+			uint16_t word;
+			std::memcpy(&word, in, sizeof(word));
+			words[position - chunkStart] ^= word;
+		}
+	}
+}
+
+void HeightmapSnapshots::WriteVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t HeightmapSnapshots::ReadVarint(const uint8_t*& in)
+{
+	uint64_t value = 0;
+	for (int shift = 0;; shift += 7)
+	{
+		uint8_t byte = *in++;
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return value;
+	}
+}
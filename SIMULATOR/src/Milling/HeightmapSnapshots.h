@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "ARMAT.h"
+#include "Milling/HeightField.h"
+
+// Stock state where milling reached Point on the move from program point Move to Move + 1
+struct SnapshotPosition
+{
+	uint64_t Move = 0;
+	ar::mat::Vec4 Point{};
+	bool AtMoveStart = true;	// Point is the start of the move, nothing of it was milled yet
+
+	inline bool IsBefore(uint64_t move) const { return Move < move || (Move == move && AtMoveStart); }
+};
+
+// Keyframes of the heightmap taken while milling, so a seek restores the nearest one and re-mills
+// only the moves after it. Every snapshot is stored as the XOR of its heights with the previous
+// snapshot's, with runs of unchanged texels collapsed, so its size follows the area milled in
+// between. Heights are compared as 16-bit words, so fixed-point stocks take half of everything,
+// and chunk by chunk, so tiles a sparse stock never allocated cost nothing to compare or keep.
+// The newest state is kept uncompressed: restoring walks the chain forward from the first
+// snapshot or backward from the newest, whichever has less to decode. When the deltas outgrow the
+// budget, every other snapshot is merged into its successor and the interval doubles. The texels
+// milling stopped at an error (see CpuMillingEngine::Mill) are kept with every snapshot as the
+// words of the mask that are set, which are few.
+class HeightmapSnapshots
+{
+public:
+	// starts a new chain, the first snapshot holds the stock at start; stopped is the mask of stopped
+	// texels, if milling keeps one
+	void Reset(const HeightField& heights, float initialHeight, SnapshotPosition start,
+		size_t budget, uint64_t interval, const std::vector<uint32_t>* stopped = nullptr);
+	inline bool IsEmpty() const { return m_Snapshots.empty(); }
+	inline size_t GetCount() const { return m_Snapshots.size(); }
+	inline uint64_t GetInterval() const { return m_Interval; }
+	// bytes held by the deltas and the stopped texels
+	inline size_t GetMemoryUsage() const { return m_DeltaBytes; }
+	// next move a snapshot should be taken at, positions up to the newest one are already covered
+	inline uint64_t GetNextMove() const { return m_Snapshots.empty() ? UINT64_MAX : m_Snapshots.back().Position.Move + m_Interval; }
+	inline bool IsDue(uint64_t move) const { return move >= GetNextMove(); }
+
+	// heights must come from milling the program in order up to position
+	void Capture(SnapshotPosition position, const HeightField& heights, const std::vector<uint32_t>* stopped = nullptr);
+	// writes the newest snapshot at or before the start of move into heights, and its mask into stopped;
+	// returns its position
+	SnapshotPosition Restore(uint64_t move, HeightField& heights, std::vector<uint32_t>* stopped = nullptr) const;
+
+private:
+	struct Snapshot
+	{
+		SnapshotPosition Position{};
+		std::vector<uint8_t> Delta{};	// from the previous snapshot, from the initial stock for the first one
+		std::vector<uint32_t> Stopped{};	// index and value of every set word of the mask
+		inline size_t GetBytes() const { return Delta.size() + Stopped.size() * sizeof(uint32_t); }
+	};
+
+	// delta format: repeated (unchanged run, changed run, changed words), runs as LEB128 varints
+	// counted over the chunks of the field one after another
+	class DeltaWriter
+	{
+	public:
+		DeltaWriter(std::vector<uint8_t>& delta) : m_Delta(delta) { m_Delta.clear(); }
+		inline void Skip(size_t words) { Flush(); m_Unchanged += words; }
+		void Write(const uint16_t* diff, size_t count);
+		// trailing unchanged words are implied
+		void Finish();
+
+	private:
+		void Flush();
+
+		std::vector<uint8_t>& m_Delta;
+		size_t m_Unchanged = 0;
+		std::vector<uint16_t> m_Changed;
+	};
+
+	// encodes heights XOR previous, both laid out like m_Latest; a null previous stands for zero words
+	void EncodeDelta(const HeightField& heights, const HeightField* previous, std::vector<uint8_t>& delta);
+	// XORs the delta into heights, allocating the tiles it changes
+	static void Apply(const std::vector<uint8_t>& delta, HeightField& heights);
+	// words of a chunk, a tile still at its fill height is expanded into buffer
+	static const uint16_t* GetChunkWords(const HeightField& heights, size_t chunk, std::vector<uint16_t>& buffer);
+	void PackStopped(const std::vector<uint32_t>* stopped, std::vector<uint32_t>& packed) const;
+	static void WriteVarint(std::vector<uint8_t>& out, uint64_t value);
+	static uint64_t ReadVarint(const uint8_t*& in);
+	void Thin();
+
+	std::vector<Snapshot> m_Snapshots;
+	HeightField m_Latest;	// heights of the newest snapshot
+	std::vector<uint16_t> m_Diff, m_Current, m_Previous;	// one chunk each
+	float m_InitialHeight = 0.0f;
+	size_t m_Budget = 0, m_DeltaBytes = 0;
+	size_t m_StoppedWords = 0;	// of the mask, 0 without one
+	uint64_t m_Interval = 1;
+};
@@ -1,9 +1,17 @@
 #pragma once
 #include <ARMAT.h>
 
+enum class HeightFormat
+{
+	Float32,	// R32F
+	Fixed16		// R16 fixed point over the stock height, see HeightField
+};
+
 struct MaterialDesc
 {
 	ar::mat::UInt2 Samples = { 1500, 1500 };
 	ar::mat::Vec3 Size = { 15, 5, 15 };
 	float BaseHeight = 1.5;
+	HeightFormat Format = HeightFormat::Float32;
+	bool Sparse = false;	// CPU heights in tiles allocated when first milled, see HeightField
 };
\ No newline at end of file
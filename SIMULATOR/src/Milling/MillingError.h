@@ -1,4 +1,8 @@
 #pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <tuple>
 
 struct MillingError
 {
@@ -6,4 +10,57 @@ struct MillingError
 	int NonCuttingContact = 0;
 	int OverPlunge = 0;
 	int DownMilling = 0;
-};
\ No newline at end of file
+};
+
+enum class MillingErrorKind : uint32_t
+{
+	NonCuttingContact,
+	OverPlunge,
+	DownMilling
+};
+
+// One located error, laid out like ErrorRecord in milling.comp
+struct MillingErrorRecord
+{
+	uint32_t Segment = 0;	// the move from Path[Segment] to Path[Segment + 1] of the milled path
+	uint32_t TexelX = 0, TexelY = 0;
+	MillingErrorKind Kind = MillingErrorKind::NonCuttingContact;
+};
+
+// Milling error tied to the program move that caused it
+struct LocatedMillingError
+{
+	uint64_t Move = 0;	// the move from point Move to Move + 1 of the whole program
+	MillingErrorKind Kind = MillingErrorKind::NonCuttingContact;
+	uint32_t TexelX = 0, TexelY = 0;	// first heightmap texel it was detected at
+};
+
+// Located errors of a single milling pass, at most one record per segment and kind
+struct MillingErrorLog
+{
+	static constexpr uint32_t s_Capacity = 1024;
+
+	std::vector<MillingErrorRecord> Records;	// ordered by segment
+	uint32_t Dropped = 0;	// distinct errors that did not fit in the capacity
+
+	inline void Clear()
+	{
+		Records.clear();
+		Dropped = 0;
+	}
+
+	// sorts by segment and keeps the first texel of every (segment, kind), then applies the capacity
+	inline void Deduplicate()
+	{
+		auto key = [](const MillingErrorRecord& r) { return std::make_tuple(r.Segment, r.Kind, r.TexelY, r.TexelX); };
+		std::sort(Records.begin(), Records.end(), [&](const auto& a, const auto& b) { return key(a) < key(b); });
+		auto last = std::unique(Records.begin(), Records.end(),
+			[](const auto& a, const auto& b) { return a.Segment == b.Segment && a.Kind == b.Kind; });
+		Records.erase(last, Records.end());
+		if (Records.size() > s_Capacity)
+		{
+			Dropped += static_cast<uint32_t>(Records.size() - s_Capacity);
+			Records.resize(s_Capacity);
+		}
+	}
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <memory>
+#include "Milling/CutterProfile.h"
+
+enum class MillingBackend
+{
+	GPU,	// milling.comp
+	CPU		// CpuMillingEngine, works without a GL context
+};
+
+enum class MillingMode
+{
+	Gather,	// every texel walks the segments that may reach it
+	Stamp	// every segment rasterizes its swept footprint, CPU only
+};
+
+// Everything the removal pass needs besides the heights and the path, in material units (cm)
+struct MillingParams
+{
+	std::shared_ptr<const CutterProfile> Profile;	// shape of the cutter's bottom
+	float CutterRadius = 0.0f;
+	float CutterHeight = 0.0f;	// cutting length
+	// rounding of the stored heights, a descend deeper than the cutting length by no more than this
+	// is not a non-cutting contact, so the error result does not depend on the height format
+	float ContactTolerance = 0.0f;
+	float BaseHeight = 0.0f;
+	float TexelWidth = 0.0f, TexelHeight = 0.0f;
+	float OffsetX = 0.0f, OffsetY = 0.0f;
+};
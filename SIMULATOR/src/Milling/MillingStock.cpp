@@ -7,7 +7,6 @@
 MillingStock::MillingStock(const MaterialDesc& material)
 	: m_Material(material)
 {
-	m_TopMesh = ar::Ref<ar::VertexArray>(ar::VertexArray::Create());
 	m_SideMesh = ar::Ref<ar::VertexArray>(ar::VertexArray::Create());
 	UpdateMaterialDesc(material);
 	InitTexture();
@@ -17,11 +16,10 @@ void MillingStock::UpdateMaterialDesc(const MaterialDesc& material)
 {
 	m_Material = material;
 	//m_HMap->ResetMap(material);
-	GenerateTopMesh();
 	GenerateSideMesh();
 }
 
-void MillingStock::Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<ar::Texture> heightMap)
+void MillingStock::Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<ar::Texture> heightMap, float heightScale)
 {
 	//AR_TRACE("Cam: {0}, {1}, {2}", cameraPos.x, cameraPos.y, cameraPos.z);
 	const ar::mat::Vec3 lightPos = { 0, 6, 0 };
@@ -29,18 +27,25 @@ void MillingStock::Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<
 
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);dslssslsssssssppppsssassssds;sssssdsssdpssss
 
-	if (!m_TopMesh)
+	if (m_Material.Samples.u < 2 || m_Material.Samples.v < 2)
 		return;
+	const float size[2] = { m_Material.Size.x, m_Material.Size.z };
+	const float lastTexel[2] = { static_cast<float>(m_Material.Samples.u - 1), static_cast<float>(m_Material.Samples.v - 1) };
 	auto shaderTop = ar::ShaderLib::Get("MillingTop");
 	shaderTop->SetMat4("u_VP", vpMat);
+	shaderTop->SetVec2("u_Size", size);
+	shaderTop->SetVec2("u_LastTexel", lastTexel);
+	shaderTop->SetFloat("u_BaseHeight", m_Material.BaseHeight);
 	shaderTop->SetVec3("u_CameraPos", cameraPos);
 	shaderTop->SetVec3("u_LightPos", lightPos);
 	shaderTop->SetVec3("u_LightColor", lightColor);
 	ar::RenderCommand::BindTexture(heightMap, 0);
 	shaderTop->SetInt("u_Heightmap", 0);
+	shaderTop->SetFloat("u_HeightScale", heightScale);
 	ar::RenderCommand::BindTexture(m_MetalTex, 1);
 	shaderTop->SetInt("u_Texture", 1);
-	ar::Renderer::Submit(ar::Primitive::Triangle, shaderTop, m_TopMesh, m_TopMesh->IsIndexed());
+	// a strip along every pair of neighbouring rows
+	ar::Renderer::Submit(ar::Primitive::TriangleStrip, shaderTop, 2 * m_Material.Samples.u, false, m_Material.Samples.v - 1);
 
 	auto shaderSide = ar::ShaderLib::Get("MillingSide");
 	shaderSide->SetMat4("u_VP", vpMat);
@@ -50,6 +55,7 @@ void MillingStock::Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<
 	shaderSide->SetVec3("u_SurfaceColor", { 0.5f, 0.5f, 1.0f });
 	ar::RenderCommand::BindTexture(heightMap, 0);
 	shaderSide->SetInt("u_Heightmap", 0);
+	shaderSide->SetFloat("u_HeightScale", heightScale);
 	ar::Renderer::Submit(ar::Primitive::Triangle, shaderSide, m_SideMesh, m_SideMesh->IsIndexed());
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	ar::DebugRenderer::Render(vpMat);
@@ -59,72 +65,6 @@ void MillingStock::Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<
 #endif
 }
 
-ar::Ref<ar::VertexArray> MillingStock::GenerateTopMesh()
-{
-	// Called only when the parameters change (size or samples)
-	if (!m_TopMesh)
-		m_TopMesh = ar::Ref<ar::VertexArray>(ar::VertexArray::Create());
-	
-	m_TopMesh->ClearBuffers();
-	auto topVerts = GenerateVertsTop();
-	auto topIndices = GenerateIndicesTop();
-	m_TopMesh->AddVertexBuffer(ar::Ref<ar::VertexBuffer>(ar::VertexBuffer::Create(topVerts)));
-	m_TopMesh->AddIndexBuffer(ar::Ref<ar::IndexBuffer>(ar::IndexBuffer::Create(topIndices)));
-	return m_TopMesh;
-}
-
-std::vector<ar::VertexPosNormTex> MillingStock::GenerateVertsTop()
-{
-	std::vector<ar::VertexPosNormTex> verts;
-	size_t size = m_Material.Samples.u * m_Material.Samples.v;
-	verts.reserve(size);
-
-	float offsetX = -m_Material.Size.x / 2;
-	float offsetZ = -m_Material.Size.z / 2;
-
-	float segLenU = m_Material.Size.x / (m_Material.Samples.u - 1);
-	float segLenV = m_Material.Size.z / (m_Material.Samples.v - 1);
-	float texLenU = 1.0f / (m_Material.Samples.u - 1);
-	float texLenV = 1.0f / (m_Material.Samples.v - 1);
-
-	for (int segV = 0; segV < m_Material.Samples.v; segV++)
-	{
-		for (int segU = 0; segU < m_Material.Samples.u; segU++)
-		{
-			ar::mat::Vec3 pos = { offsetX + segU * segLenU, m_Material.BaseHeight, offsetZ + segV * segLenV };
-			ar::mat::Vec3 normal = { 0.0f, 1.0f, 0.0f };
-			ar::mat::Vec2 tex = { segU * texLenU, 1.0f - segV * texLenV };
-			verts.push_back({ pos, normal, tex });
-#ifdef DEBUG
-			ar::DebugRenderer::AddLine(pos, pos + normal);
-#endif
-		}
-	}
-	return verts;
-}
-
-std::vector<uint32_t> MillingStock::GenerateIndicesTop() 
-{
-	std::vector<uint32_t> indices;
-	for (uint32_t v = 0; v < m_Material.Samples.v - 1; v++) 
-	{
-		for (uint32_t u = 0; u < m_Material.Samples.u - 1; u++)
-		{ 
-			// first triangle 
-			
-			indices.push_back(v * m_Material.Samples.u + u);
-			indices.push_back((v + 1) * m_Material.Samples.u + u);
-			indices.push_back(v * m_Material.Samples.u + u + 1);
-			
-			// second triangle
-			indices.push_back((v + 1) * m_Material.Samples.u + u);
-			indices.push_back((v + 1) * m_Material.Samples.u + u + 1);
-			indices.push_back(v * m_Material.Samples.u + u + 1);
-		} 
-	} 
-	return indices;
-}
-
 ar::Ref<ar::VertexArray> MillingStock::GenerateSideMesh()
 {
 	// Called only when the parameters change (size or samples)
@@ -239,6 +179,7 @@ std::vector<ar::VertexPosNormTex> MillingStock::GenerateVertsSide()
 std::vector<uint32_t> MillingStock::GenerateIndicesSide()
 {
 	std::vector<uint32_t> indices;
+	indices.reserve(12 * (m_Material.Samples.u - 1 + m_Material.Samples.v - 1));
 	uint32_t offset = 0;
 
 	// Bottom side (Samples.u vertices)
@@ -4,26 +4,25 @@
 #include "Tools/Heightmap.h"
 #include "MaterialDesc.h"
 
+// Renders the stock: the top follows the heightmap, the sides run from its edges down to y = 0.
+// The top has no vertex or index buffers, its vertex shader rebuilds every vertex from its texel
+// (see millingTop.vert), so a change of the material only regenerates the sides.
 class MillingStock
 {
 public:
 	MillingStock(const MaterialDesc& material);
 	
 	void UpdateMaterialDesc(const MaterialDesc& material);
-	void Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<ar::Texture> heightMap);
-	inline const ar::Ref<ar::VertexArray> GetMesh() const { return m_TopMesh; }
+	// heightScale turns heightmap texels into cm, see Heightmap::GetHeightScale
+	void Render(ar::mat::Mat4 vpMat, ar::mat::Vec3 cameraPos, ar::Ref<ar::Texture> heightMap, float heightScale);
 
 private:
-	ar::Ref<ar::VertexArray> GenerateTopMesh();
-	std::vector<ar::VertexPosNormTex> GenerateVertsTop();
-	std::vector<uint32_t> GenerateIndicesTop();
-
 	ar::Ref<ar::VertexArray> GenerateSideMesh();
 	std::vector<ar::VertexPosNormTex> GenerateVertsSide();
 	std::vector<uint32_t> GenerateIndicesSide();
 	void InitTexture();
 
 	MaterialDesc m_Material;
-	ar::Ref<ar::VertexArray> m_TopMesh, m_SideMesh;
+	ar::Ref<ar::VertexArray> m_SideMesh;
 	ar::Ref<ar::Texture> m_MetalTex;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "RemovalStats.h"
+#include <fstream>
+#include <fmt/format.h>
+
+void RemovalStats::Clear()
+{
+	m_Moves.clear();
+	m_TotalVolume = 0.0;
+	m_AirCuts = 0;
+}
+
+MoveRemoval RemovalStats::Add(uint64_t firstMove, const std::vector<ar::mat::Vec4>& path, const std::vector<float>& volumes)
+{
+	MoveRemoval pass;
+	if (path.size() < 2)
+		return pass;
+	if (m_Moves.size() < firstMove + path.size() - 1)
+		m_Moves.resize(firstMove + path.size() - 1);
+	for (size_t i = 0; i + 1 < path.size() && i < volumes.size(); ++i)
+	{
+		auto& move = m_Moves[firstMove + i];
+		// a move milled over several passes may stop counting as an air cut
+		m_AirCuts -= IsAirCut(move);
+		float length = ar::mat::Length(ar::mat::ToVec3(path[i + 1]) - ar::mat::ToVec3(path[i]));
+		move.Length += length;
+		move.Volume += volumes[i];
+		m_AirCuts += IsAirCut(move);
+		pass.Length += length;
+		pass.Volume += volumes[i];
+	}
+	m_TotalVolume += pass.Volume;
+	return pass;
+}
+
+void RemovalStats::Truncate(uint64_t move)
+{
+	if (move >= m_Moves.size())
+		return;
+	for (auto i = move; i < m_Moves.size(); ++i)
+	{
+		m_TotalVolume -= m_Moves[i].Volume;
+		m_AirCuts -= IsAirCut(m_Moves[i]);
+	}
+	m_Moves.resize(move);
+}
+
+bool RemovalStats::Export(const std::filesystem::path& filepath) const
+{
+	std::ofstream file(filepath);
+	if (!file)
+		return false;
+	fmt::memory_buffer buffer;
+	fmt::format_to(std::back_inserter(buffer), "move,length_cm,volume_cm3,section_cm2\n");
+	for (size_t i = 0; i < m_Moves.size(); ++i)
+	{
+		auto& move = m_Moves[i];
+		if (move.Length <= 0.0f)
+			continue;
+		fmt::format_to(std::back_inserter(buffer), "{},{:.5f},{:.6f},{:.6f}\n", i, move.Length, move.Volume,
+			move.Volume / move.Length);
+		if (buffer.size() >= (1 << 20))
+		{
+			file.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	}
+	file.write(buffer.data(), buffer.size());
+	return file.good();
+}
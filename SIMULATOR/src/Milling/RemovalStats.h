@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <filesystem>
+#include "ARMAT.h"
+
+// Path length and material removed by one program move, summed over the passes that milled it
+struct MoveRemoval
+{
+	float Length = 0.0f;	// in cm
+	float Volume = 0.0f;	// in cm^3
+};
+
+// Per-move table of the material a program removed, filled from the volumes the milling passes report.
+// Moves that removed nothing are air cuts that could run as rapids, a high volume per cm points at
+// overloaded moves. Moves never milled keep zero length and are left out.
+class RemovalStats
+{
+public:
+	static constexpr float s_AirCutVolume = 1e-6f;	// in cm^3, below this a move counts as cutting air
+
+	void Clear();
+	// path[0] is program point firstMove, volumes[i] is what the segment from path[i] to path[i + 1] removed;
+	// returns the totals of this pass
+	MoveRemoval Add(uint64_t firstMove, const std::vector<ar::mat::Vec4>& path, const std::vector<float>& volumes);
+	// forgets the moves from move on, before they are milled again
+	void Truncate(uint64_t move);
+
+	inline const std::vector<MoveRemoval>& GetMoves() const { return m_Moves; }
+	inline double GetTotalVolume() const { return m_TotalVolume; }
+	inline size_t CountAirCuts() const { return m_AirCuts; }
+	// CSV, one row per milled move: move, length [cm], volume [cm^3], volume per length [cm^2]
+	bool Export(const std::filesystem::path& filepath) const;
+
+private:
+	std::vector<MoveRemoval> m_Moves;
+	double m_TotalVolume = 0.0;
+	size_t m_AirCuts = 0;
+
+	static inline bool IsAirCut(const MoveRemoval& move) { return move.Length > 0.0f && move.Volume < s_AirCutVolume; }
+};
@@ -0,0 +1,74 @@
+#include "SegmentBins.h"
+#include <algorithm>
+#include <cmath>
+
+void SegmentBins::Build(const std::vector<ar::mat::Vec4>& path, uint32_t samplesX, uint32_t samplesY,
+	const MillingParams& params, uint32_t tileSize)
+{
+	m_TileSize = tileSize;
+	m_OriginX = m_OriginY = 0;
+	m_TilesX = m_TilesY = 0;
+	m_DirtyRect = {};
+	m_Offsets.assign(1, 0);
+	m_Indices.clear();
+	if (path.size() < 2)
+		return;
+
+	// footprints first, their union decides which tiles get a bin
+	std::vector<TexelRect> rects(path.size() - 1);
+	std::vector<uint8_t> visible(path.size() - 1);
+	bool any = false;
+	for (size_t seg = 0; seg + 1 < path.size(); ++seg)
+	{
+		visible[seg] = GetTexelRect(path[seg], path[seg + 1], samplesX, samplesY, params, rects[seg]);
+		if (!visible[seg])
+			continue;
+		auto& rect = rects[seg];
+		if (!any)
+			m_DirtyRect = rect;
+		m_DirtyRect.MinX = std::min(m_DirtyRect.MinX, rect.MinX);
+		m_DirtyRect.MinY = std::min(m_DirtyRect.MinY, rect.MinY);
+		m_DirtyRect.MaxX = std::max(m_DirtyRect.MaxX, rect.MaxX);
+		m_DirtyRect.MaxY = std::max(m_DirtyRect.MaxY, rect.MaxY);
+		any = true;
+	}
+	if (!any)
+		return;	// no segment reaches the stock
+	m_OriginX = m_DirtyRect.MinX / tileSize;
+	m_OriginY = m_DirtyRect.MinY / tileSize;
+	m_TilesX = (m_DirtyRect.MaxX - 1) / tileSize - m_OriginX + 1;
+	m_TilesY = (m_DirtyRect.MaxY - 1) / tileSize - m_OriginY + 1;
+
+	// counting pass, then a prefix sum turns counts into offsets
+	m_Offsets.assign(GetTileCount() + 1, 0);
+	for (size_t seg = 0; seg < rects.size(); ++seg)
+		if (visible[seg])
+			ForEachTile(rects[seg], [this](uint32_t tile) { m_Offsets[tile + 1]++; });
+	for (size_t tile = 0; tile < GetTileCount(); ++tile)
+		m_Offsets[tile + 1] += m_Offsets[tile];
+
+	// segments are visited in path order, which keeps every bin sorted
+	m_Indices.resize(m_Offsets.back());
+	std::vector<uint32_t> cursor(m_Offsets.begin(), m_Offsets.end() - 1);
+	for (size_t seg = 0; seg < rects.size(); ++seg)
+		if (visible[seg])
+			ForEachTile(rects[seg], [&](uint32_t tile) { m_Indices[cursor[tile]++] = static_cast<uint32_t>(seg); });
+}
+
+bool SegmentBins::GetTexelRect(ar::mat::Vec4 start, ar::mat::Vec4 end, uint32_t samplesX, uint32_t samplesY,
+	const MillingParams& params, TexelRect& rect)
+{
+	// texel i sits at Offset + i * TexelSize; rounding outwards keeps the range conservative
+	float minX = std::floor((std::min(start.x, end.x) - params.CutterRadius - params.OffsetX) / params.TexelWidth);
+	float maxX = std::ceil((std::max(start.x, end.x) + params.CutterRadius - params.OffsetX) / params.TexelWidth);
+	float minY = std::floor((std::min(start.y, end.y) - params.CutterRadius - params.OffsetY) / params.TexelHeight);
+	float maxY = std::ceil((std::max(start.y, end.y) + params.CutterRadius - params.OffsetY) / params.TexelHeight);
+	if (maxX < 0.0f || maxY < 0.0f || minX >= samplesX || minY >= samplesY)
+		return false;
+
+	rect.MinX = static_cast<uint32_t>(std::max(minX, 0.0f));
+	rect.MinY = static_cast<uint32_t>(std::max(minY, 0.0f));
+	rect.MaxX = static_cast<uint32_t>(std::min(maxX, samplesX - 1.0f)) + 1;
+	rect.MaxY = static_cast<uint32_t>(std::min(maxY, samplesY - 1.0f)) + 1;
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <span>
+#include "ARMAT.h"
+#include "Milling/MillingParams.h"
+
+// Rectangle of heightmap texels, [Min, Max) on both axes
+struct TexelRect
+{
+	uint32_t MinX = 0, MinY = 0, MaxX = 0, MaxY = 0;
+
+	inline uint32_t GetWidth() const { return MaxX - MinX; }
+	inline uint32_t GetHeight() const { return MaxY - MinY; }
+	inline bool IsEmpty() const { return MaxX <= MinX || MaxY <= MinY; }
+};
+
+// Buckets path segments into square texel tiles by the XY bounding box of the cutter swept along
+// them. Each tile lists its segments in path order, so sequential removal and the error checks
+// see the same sequence as with the full path. Only the tiles under the dirty rectangle (the union
+// of the segments' footprints) are allocated, so a short path costs as much as the area it sweeps.
+class SegmentBins
+{
+public:
+	void Build(const std::vector<ar::mat::Vec4>& path, uint32_t samplesX, uint32_t samplesY,
+		const MillingParams& params, uint32_t tileSize);
+
+	inline uint32_t GetTileSize() const { return m_TileSize; }
+	// first binned tile, tile (x, y) of the bins covers texels from ((Origin + (x, y)) * TileSize)
+	inline uint32_t GetOriginX() const { return m_OriginX; }
+	inline uint32_t GetOriginY() const { return m_OriginY; }
+	inline uint32_t GetTilesX() const { return m_TilesX; }
+	inline uint32_t GetTilesY() const { return m_TilesY; }
+	inline uint32_t GetTileCount() const { return m_TilesX * m_TilesY; }
+	inline bool IsEmpty() const { return m_Indices.empty(); }
+	// texels the segments can reach, empty if none does
+	inline const TexelRect& GetDirtyRect() const { return m_DirtyRect; }
+	inline std::span<const uint32_t> GetSegments(uint32_t tile) const
+	{
+		return { m_Indices.data() + m_Offsets[tile], m_Offsets[tile + 1] - m_Offsets[tile] };
+	}
+	// CSR layout uploaded to the compute shader: tile t owns Indices[Offsets[t], Offsets[t + 1])
+	inline const std::vector<uint32_t>& GetOffsets() const { return m_Offsets; }
+	inline const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+private:
+	static bool GetTexelRect(ar::mat::Vec4 start, ar::mat::Vec4 end, uint32_t samplesX, uint32_t samplesY,
+		const MillingParams& params, TexelRect& rect);
+	// calls func with the index of every bin the texel rectangle overlaps
+	template<typename Func>
+	void ForEachTile(const TexelRect& rect, Func func) const
+	{
+		for (uint32_t y = rect.MinY / m_TileSize; y <= (rect.MaxY - 1) / m_TileSize; ++y)
+			for (uint32_t x = rect.MinX / m_TileSize; x <= (rect.MaxX - 1) / m_TileSize; ++x)
+				func((y - m_OriginY) * m_TilesX + (x - m_OriginX));
+	}
+
+	uint32_t m_TileSize = 16, m_OriginX = 0, m_OriginY = 0, m_TilesX = 0, m_TilesY = 0;
+	TexelRect m_DirtyRect;
+	std::vector<uint32_t> m_Offsets, m_Indices;
+};
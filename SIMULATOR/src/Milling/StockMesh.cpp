@@ -0,0 +1,244 @@
+#include "StockMesh.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+
+StockMesh::StockMesh(const HeightField& heights, const MaterialDesc& material)
+	: m_SamplesX(heights.GetSamplesX()), m_SamplesY(heights.GetSamplesY()),
+	m_TexelCount(static_cast<uint32_t>(heights.GetCount())), m_Material(material)
+{
+	if (m_SamplesX < 2 || m_SamplesY < 2)
+		return;
+
+	// bands share their boundary row, every band owns the cells starting in its rows
+	uint32_t cellRows = m_SamplesY - 1;
+	std::vector<uint32_t> bands((cellRows + s_BandRows - 1) / s_BandRows);
+	std::iota(bands.begin(), bands.end(), 0);
+	std::vector<std::vector<Triangle>> bandTriangles(bands.size());
+	std::for_each(std::execution::par, bands.begin(), bands.end(), [&](uint32_t band) {
+		BuildBand(heights, band * s_BandRows, std::min((band + 1) * s_BandRows, cellRows), bandTriangles[band]);
+		});
+
+	size_t count = 0;
+	for (auto& triangles : bandTriangles)
+		count += triangles.size();
+	m_Triangles.reserve(count + 4 * (m_SamplesX + m_SamplesY) + 2);
+	for (auto& triangles : bandTriangles)
+		m_Triangles.insert(m_Triangles.end(), triangles.begin(), triangles.end());
+	bandTriangles.clear();
+	BuildWalls(heights, m_Triangles);
+
+	// only the vertices some triangle uses are kept, in key order
+	std::vector<uint32_t> keys;
+	keys.reserve(3 * m_Triangles.size());
+	for (auto& triangle : m_Triangles)
+		keys.insert(keys.end(), triangle.begin(), triangle.end());
+	std::sort(std::execution::par, keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	m_Positions.resize(keys.size());
+	std::transform(std::execution::par, keys.begin(), keys.end(), m_Positions.begin(),
+		[&](uint32_t key) { return GetPosition(heights, key); });
+	std::for_each(std::execution::par, m_Triangles.begin(), m_Triangles.end(), [&](Triangle& triangle) {
+		for (auto& corner : triangle)
+			corner = static_cast<uint32_t>(std::lower_bound(keys.begin(), keys.end(), corner) - keys.begin());
+		});
+}
+
+void StockMesh::BuildBand(const HeightField& heights, uint32_t fromY, uint32_t toY, std::vector<Triangle>& triangles) const
+{
+	// rows fromY..toY inclusive, the cells between them are this band's
+	uint32_t rows = toY - fromY + 1, cellsX = m_SamplesX - 1;
+	std::vector<float> band(static_cast<size_t>(rows) * m_SamplesX);
+	heights.ReadBlock(0, fromY, m_SamplesX, rows, band.data(), m_SamplesX);
+	auto at = [&](uint32_t x, uint32_t y) { return band[static_cast<size_t>(y) * m_SamplesX + x]; };
+	auto isFlat = [&](uint32_t x, uint32_t y, float height) {
+		return at(x, y) == height && at(x + 1, y) == height && at(x, y + 1) == height && at(x + 1, y + 1) == height;
+	};
+
+	std::vector<uint8_t> merged(static_cast<size_t>(rows - 1) * cellsX, 0);
+	for (uint32_t y = 0; y + 1 < rows; ++y)
+	{
+		for (uint32_t x = 0; x < cellsX; ++x)
+		{
+			if (merged[static_cast<size_t>(y) * cellsX + x])
+				continue;
+			float height = at(x, y);
+			if (!isFlat(x, y, height))
+			{
+				AddQuad(triangles, x, fromY + y, x + 1, fromY + y + 1, false);
+				continue;
+			}
+			// widest run of flat cells at this height, then as many rows below as repeat it
+			uint32_t endX = x + 1;
+			while (endX < cellsX && !merged[static_cast<size_t>(y) * cellsX + endX] && isFlat(endX, y, height))
+				endX++;
+			uint32_t endY = y + 1;
+			for (; endY + 1 < rows; ++endY)
+			{
+				bool rowFlat = true;
+				for (uint32_t i = x; i < endX && rowFlat; ++i)
+					rowFlat = !merged[static_cast<size_t>(endY) * cellsX + i] && isFlat(i, endY, height);
+				if (!rowFlat)
+					break;
+			}
+			for (uint32_t j = y; j < endY; ++j)
+				std::fill_n(merged.begin() + static_cast<size_t>(j) * cellsX + x, endX - x, uint8_t(1));
+			AddQuad(triangles, x, fromY + y, endX, fromY + endY, false);
+			x = endX - 1;
+		}
+	}
+}
+
+void StockMesh::BuildWalls(const HeightField& heights, std::vector<Triangle>& triangles) const
+{
+	uint32_t lastX = m_SamplesX - 1, lastY = m_SamplesY - 1;
+	// texels along one edge, outward is on the left of the walk seen from above the stock
+	auto addWall = [&](uint32_t x, uint32_t y, uint32_t stepX, uint32_t stepY, uint32_t count, bool reversed) {
+		std::vector<float> edge(count);
+		for (uint32_t i = 0; i < count; ++i)
+			edge[i] = heights.Get(static_cast<size_t>(y + i * stepY) * m_SamplesX + x + i * stepX);
+		for (uint32_t i = 0; i + 1 < count;)
+		{
+			// a run of equal heights is a single rectangle
+			uint32_t end = i + 1;
+			if (edge[end] == edge[i])
+				while (end + 1 < count && edge[end + 1] == edge[i])
+					end++;
+			uint32_t top0 = (y + i * stepY) * m_SamplesX + x + i * stepX;
+			uint32_t top1 = (y + end * stepY) * m_SamplesX + x + end * stepX;
+			uint32_t bottom0 = m_TexelCount + top0, bottom1 = m_TexelCount + top1;
+			if (reversed)
+			{
+				triangles.push_back({ bottom1, bottom0, top0 });
+				triangles.push_back({ bottom1, top0, top1 });
+			}
+			else
+			{
+				triangles.push_back({ bottom0, bottom1, top1 });
+				triangles.push_back({ bottom0, top1, top0 });
+			}
+			i = end;
+		}
+	};
+	// row 0 is the stock's +z side, rows run towards -z
+	addWall(0, 0, 1, 0, m_SamplesX, false);
+	addWall(lastX, 0, 0, 1, m_SamplesY, false);
+	addWall(0, lastY, 1, 0, m_SamplesX, true);
+	addWall(0, 0, 0, 1, m_SamplesY, true);
+	AddQuad(triangles, 0, 0, lastX, lastY, true);
+}
+
+void StockMesh::AddQuad(std::vector<Triangle>& triangles, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, bool bottom) const
+{
+	uint32_t offset = bottom ? m_TexelCount : 0;
+	uint32_t a = offset + y0 * m_SamplesX + x0, b = offset + y0 * m_SamplesX + x1;
+	uint32_t c = offset + y1 * m_SamplesX + x0, d = offset + y1 * m_SamplesX + x1;
+	// counter-clockwise seen from outside, the same diagonal as the rendered top mesh
+	if (bottom)
+	{
+		triangles.push_back({ a, d, b });
+		triangles.push_back({ a, c, d });
+	}
+	else
+	{
+		triangles.push_back({ a, b, d });
+		triangles.push_back({ a, d, c });
+	}
+}
+
+ar::mat::Vec3 StockMesh::GetPosition(const HeightField& heights, uint32_t key) const
+{
+	bool bottom = key >= m_TexelCount;
+	uint32_t texel = bottom ? key - m_TexelCount : key;
+	uint32_t x = texel % m_SamplesX, y = texel / m_SamplesX;
+	float height = bottom ? 0.0f : m_Material.BaseHeight + heights.Get(texel);
+	return { -m_Material.Size.x / 2 + x * m_Material.Size.x / (m_SamplesX - 1), height,
+		-m_Material.Size.z / 2 + (m_SamplesY - 1 - y) * m_Material.Size.z / (m_SamplesY - 1) };
+}
+
+bool StockMesh::Export(const std::filesystem::path& filepath) const
+{
+	auto extension = filepath.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+	if (extension != ".stl" && extension != ".obj")
+		return false;
+	std::ofstream file(filepath, std::ios::binary);
+	if (!file)
+		return false;
+	return extension == ".stl" ? ExportSTL(file) : ExportOBJ(file);
+}
+
+bool StockMesh::ExportSTL(std::ofstream& file) const
+{
+	// binary STL: 80-byte header, triangle count, then normal, corners and an attribute word per triangle
+	constexpr size_t triangleBytes = 12 * sizeof(float) + sizeof(uint16_t);
+	char header[80] = {};
+	std::snprintf(header, sizeof(header), "milled stock, cm");
+	auto count = static_cast<uint32_t>(m_Triangles.size());
+	file.write(header, sizeof(header));
+	file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+	std::vector<char> block;
+	std::vector<size_t> indices;
+	for (size_t start = 0; start < m_Triangles.size(); start += s_BlockSize)
+	{
+		size_t end = std::min(start + s_BlockSize, m_Triangles.size());
+		block.assign((end - start) * triangleBytes, 0);
+		indices.resize(end - start);
+		std::iota(indices.begin(), indices.end(), start);
+		std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i) {
+			auto& triangle = m_Triangles[i];
+			auto& p0 = m_Positions[triangle[0]];
+			auto& p1 = m_Positions[triangle[1]];
+			auto& p2 = m_Positions[triangle[2]];
+			auto normal = ar::mat::Cross(p1 - p0, p2 - p0);
+			float length = ar::mat::Length(normal);
+			normal = length > 0.0f ? normal / length : ar::mat::Vec3{ 0.0f, 0.0f, 0.0f };
+			float values[12] = { normal.x, normal.y, normal.z, p0.x, p0.y, p0.z, p1.x, p1.y, p1.z, p2.x, p2.y, p2.z };
+			std::memcpy(block.data() + (i - start) * triangleBytes, values, sizeof(values));
+			});
+		file.write(block.data(), block.size());
+	}
+	return file.good();
+}
+
+bool StockMesh::ExportOBJ(std::ofstream& file) const
+{
+	// every block is split into slices formatted in parallel, then written in order
+	constexpr size_t slices = 16;
+	std::vector<fmt::memory_buffer> buffers(slices);
+	std::vector<size_t> sliceIndices(slices);
+	std::iota(sliceIndices.begin(), sliceIndices.end(), 0);
+	auto writeBlocks = [&](size_t count, auto&& format) {
+		for (size_t start = 0; start < count; start += s_BlockSize)
+		{
+			size_t end = std::min(start + s_BlockSize, count);
+			size_t sliceSize = (end - start + slices - 1) / slices;
+			std::for_each(std::execution::par, sliceIndices.begin(), sliceIndices.end(), [&](size_t slice) {
+				auto& buffer = buffers[slice];
+				buffer.clear();
+				size_t from = start + slice * sliceSize, to = std::min(from + sliceSize, end);
+				for (size_t i = from; i < to; ++i)
+					format(buffer, i);
+				});
+			for (auto& buffer : buffers)
+				file.write(buffer.data(), buffer.size());
+		}
+	};
+
+	file << "# milled stock, cm\n";
+	writeBlocks(m_Positions.size(), [&](fmt::memory_buffer& buffer, size_t i) {
+		auto& p = m_Positions[i];
+		fmt::format_to(std::back_inserter(buffer), "v {:.5f} {:.5f} {:.5f}\n", p.x, p.y, p.z);
+		});
+	writeBlocks(m_Triangles.size(), [&](fmt::memory_buffer& buffer, size_t i) {
+		auto& triangle = m_Triangles[i];
+		fmt::format_to(std::back_inserter(buffer), "f {} {} {}\n", triangle[0] + 1, triangle[1] + 1, triangle[2] + 1);
+		});
+	return file.good();
+}
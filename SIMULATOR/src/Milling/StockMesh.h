@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+#include "ARMAT.h"
+#include "Milling/HeightField.h"
+#include "Milling/MaterialDesc.h"
+
+// Closed surface of the milled stock for export, in cm and placed like the rendered stock: the top
+// follows the heights, four side walls run from it down to y = 0 like MillingStock's side mesh and
+// a bottom closes them. Texels at exactly the same height are merged into rectangles greedily, so
+// the untouched top and flat pocket floors take a couple of triangles each, and the walls are
+// merged the same way along their top edge. A merged edge only meets finer triangles at points
+// lying on it, so the surface has T-junctions but no cracks; curved areas keep two triangles per
+// texel cell. Row bands are triangulated in parallel.
+class StockMesh
+{
+public:
+	StockMesh(const HeightField& heights, const MaterialDesc& material);
+
+	inline size_t GetTriangleCount() const { return m_Triangles.size(); }
+	inline size_t GetVertexCount() const { return m_Positions.size(); }
+	// binary STL or OBJ by the extension, formatted in parallel and written a block at a time
+	bool Export(const std::filesystem::path& filepath) const;
+
+private:
+	// corners: texel keys (y * samplesX + x) while building, indices into m_Positions once done;
+	// keys past the texel count are the same texel at the bottom of the stock
+	using Triangle = std::array<uint32_t, 3>;
+	static constexpr uint32_t s_BandRows = 64;
+	static constexpr size_t s_BlockSize = 1 << 16;	// triangles or vertices per written block
+
+	void BuildBand(const HeightField& heights, uint32_t fromY, uint32_t toY, std::vector<Triangle>& triangles) const;
+	void BuildWalls(const HeightField& heights, std::vector<Triangle>& triangles) const;
+	void AddQuad(std::vector<Triangle>& triangles, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, bool bottom) const;
+	ar::mat::Vec3 GetPosition(const HeightField& heights, uint32_t key) const;
+	bool ExportSTL(std::ofstream& file) const;
+	bool ExportOBJ(std::ofstream& file) const;
+
+	uint32_t m_SamplesX, m_SamplesY;
+	uint32_t m_TexelCount;
+	MaterialDesc m_Material;
+	std::vector<Triangle> m_Triangles;
+	std::vector<ar::mat::Vec3> m_Positions;
+};
@@ -32,10 +32,10 @@ void SimRenderer::RenderGrid(ar::mat::Mat4 vp)
 }
 
 void SimRenderer::RenderMaterial(ar::mat::Mat4 vp, ar::mat::Vec3 cameraPos, MillingStock& block,
-	ar::Ref<ar::Texture> heightMap)
+	ar::Ref<ar::Texture> heightMap, float heightScale)
 {
 	m_Framebuffer->Bind();
-	block.Render(vp, cameraPos, heightMap);
+	block.Render(vp, cameraPos, heightMap, heightScale);
 	m_Framebuffer->Unbind();
 }
 
@@ -12,7 +12,7 @@ public:
 	void Render(ar::mat::Mat4 vp);
 	void RenderPaths(ar::Ref<ar::VertexArray> path, ar::mat::Mat4 vp);
 	void RenderMaterial(ar::mat::Mat4 vp, ar::mat::Vec3 cameraPos, MillingStock& block,
-		ar::Ref<ar::Texture> heightMap);
+		ar::Ref<ar::Texture> heightMap, float heightScale);
 
 	ar::Ref<ar::Framebuffer> GetFramebuffer() const { return m_Framebuffer; }
 private:
@@ -2,7 +2,11 @@
 #include <vector>
 #include <string>
 #include "Milling/MaterialDesc.h"
-#include "Milling/CutterType.h"
+#include "Milling/CutterDesc.h"
+#include <optional>
+#include "Milling/MillingParams.h"
+#include "Milling/MillingError.h"
+#include "Tools/MachiningTime.h"
 #include <filesystem>
 
 namespace fs = std::filesystem;
@@ -12,6 +16,29 @@ struct ViewportSize
 	float Width = 0, Height = 0;
 };
 
+enum class JobStatus
+{
+	Pending,
+	Running,
+	Done,
+	Failed
+};
+
+// Summary of one program of a job
+struct JobProgramResult
+{
+	fs::path		Filepath;
+	JobStatus		Status = JobStatus::Pending;
+	std::optional<CutterDesc> Cutter;	// read from the extension once the program starts
+	uint64_t		Points = 0;
+	float			ParseTime = 0.0f, MillTime = 0.0f, TotalTime = 0.0f;	// in ms
+	MillingError	Error;
+	size_t			ErrorCount = 0;		// located errors, dropped ones included
+	double			RemovedVolume = 0.0;	// in cm^3
+	double			MachiningTime = 0.0;	// in s, estimated at the programmed feeds
+	std::string		Message;	// why the program could not be run
+};
+
 class SimState
 {
 public:
@@ -27,24 +54,36 @@ public:
 		ErrorMessages.clear();
 		ShowErrorModal = false;
 	}
+	std::vector<LocatedMillingError> MillingErrors;	// one entry per move and kind, in program order
+	uint32_t		DroppedMillingErrors = 0;		// errors past the capacity of the error log
+	bool			ShouldJumpToError = false;
+	size_t			SelectedError = 0;
 
 	// ============ LOADING ===============
-	fs::path		Filepath;
+	fs::path		Filepath;		// of the loaded program
+	fs::path		ImportPath;		// becomes Filepath once it loads
 	bool			ShouldImport = false;
 	inline void ClearImportState()
 	{
 		ShouldImport = false;
+		ImportPath.clear();
 	}
 
 	// ============ MILLING ===============
 	MaterialDesc	Material{};
 	bool			ShouldReset = false;
+	bool			ShouldExportMesh = false;	// milled stock as STL or OBJ
+	fs::path		MeshExportPath;
 	float			SimulationSpeed = 10.0;
 	bool			ShouldMillInstant = false;
-	float			CutterSize = 1.0;
-	float			CutterHeight = 4.0;
-	CutterType		CutterType = CutterType::FLAT;
+	bool			IsMillingInstant = false;	// instant milling goes one program window per frame
+	float			StreamProgress = 0.0f;		// fraction of the program read so far
+	CutterDesc		Cutter{};
 	bool			ShouldShowPaths = false;
+	MillingBackend	Backend = MillingBackend::GPU;
+	MillingMode		Mode = MillingMode::Gather;
+	bool			ShouldChangeEngine = false;
+	float			MillTime = 0.0f;	// duration of the last heightmap update in ms
 
 	// ============ SIMULATION =============
 	bool			SimulationBegan = false;
@@ -52,16 +91,59 @@ public:
 	bool			PlaySimulation = false;
 	bool			IsSimulationRun = false;
 	bool			IsSimulationComplete = false;
+	bool			FixedStep = false;			// whole ticks of the speed, the same stops at any frame rate
+	uint32_t		TickRate = 120;				// ticks per second
+	uint32_t		MaxTicksPerFrame = 32;		// milled in one dispatch, a slower frame drops the rest
 	uint32_t		StartIndex;
 	ar::mat::Vec4	StartPoint;
+	float			PathProgress = 0.0f;		// fraction of the program's path length behind the cutter
 	inline void RestartSim(ar::mat::Vec4 p)
 	{
 		SimulationBegan = false;
 		IsSimulationComplete = false;
 		StartIndex = 0;
 		StartPoint = p;
+		PathProgress = 0.0f;
+		MillingErrors.clear();
+		DroppedMillingErrors = 0;
 	}
 
+	// ============ MACHINING TIME =========
+	MachineLimits	Machine{};
+	bool			ShouldEstimateTime = false;	// again, after the limits changed
+	double			MachiningTime = 0.0;		// in s, of the loaded program, negative while it is estimated
+	double			ProgramLength = 0.0;		// in cm, of the loaded program, 0 until estimated
+	bool			RealTimePlayback = false;	// play at the programmed feeds instead of SimulationSpeed
+	float			PlaybackScale = 1.0f;		// machine seconds per second of playback
+
+	// ============ JOB ====================
+	std::vector<JobProgramResult> Job;	// programs milled back to back on one stock, in order
+	bool			ShouldRunJob = false;
+	bool			IsJobRunning = false;
+	size_t			JobIndex = 0;		// program being milled
+	float			JobTime = 0.0f;		// in ms, of the last run
+
+	// ============ REMOVAL ================
+	double			RemovedVolume = 0.0;	// in cm^3, since the last reset or import
+	float			RemovalRate = -1.0f;	// in cm^3/s of machining time over the last played back update, negative if none
+	size_t			AirCuts = 0;			// milled moves that removed no material
+	bool			ShouldExportRemoval = false;
+	fs::path		RemovalExportPath;
+
+	// ============ SNAPSHOTS ==============
+	int				SnapshotBudget = 256;		// in MB, takes effect on the next reset or import
+	uint32_t		SnapshotInterval = 500;		// moves between snapshots of a new chain
+	size_t			SnapshotCount = 0;
+	size_t			SnapshotMemory = 0;			// in bytes
+	uint64_t		CurrentSnapshotInterval = 0;	// grows as the budget runs out
+	bool			ShouldSeek = false;
+	uint64_t		SeekMove = 0;
+	bool			ShouldSeekTime = false;
+	double			SeekTime = 0.0;				// in s into the program at the feeds, as real time plays it
+	bool			ShouldScrub = false;
+	bool			IsScrubbing = false;		// the progress slider is held
+	float			ScrubPercent = 0.0f;		// of the program's path length
+
 	// ============ MISC ===================
 	float			FPS = 0.0f;
 };
\ No newline at end of file
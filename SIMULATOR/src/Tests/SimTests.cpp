@@ -0,0 +1,306 @@
+#include "SimTests.h"
+#include "Milling/CpuMillingEngine.h"
+#include "Milling/HeightmapSnapshots.h"
+#include "Tools/GCodeTools.h"
+#include "Tools/MachiningTime.h"
+#include "Tools/PathTable.h"
+#include "Tools/CutterStepper.h"
+#include <random>
+#include <numeric>
+#include <cmath>
+
+uint32_t SimTests::s_Failures = 0;
+
+bool SimTests::TestMillingSuite()
+{
+	Trace("===== Running Milling Test Suite =====");
+	s_Failures = 0;
+	TestMilling_GatherMatchesStamp();
+	TestMilling_FixedStepIgnoresFrameTimes();
+	TestMilling_SnapshotRestoreMatchesMilling();
+	TestMilling_StoppedTexelsCarryAcrossCalls();
+	Trace("===== Milling Test Suite Complete: {0} failed =====", s_Failures);
+	return s_Failures == 0;
+}
+
+void SimTests::TestMilling_GatherMatchesStamp()
+{
+	auto path = GetTestPath();
+	for (auto [format, sparse] : { std::pair{ HeightFormat::Float32, false }, std::pair{ HeightFormat::Fixed16, true } })
+	{
+		auto material = GetTestMaterial(format, sparse);
+		auto params = GetTestParams(material);
+		Trace("Testing gather against stamp on {0} {1} heights...", format == HeightFormat::Float32 ? "float" : "fixed16",
+			sparse ? "sparse" : "dense");
+
+		std::vector<float> heights[2];
+		double volumes[2];
+		for (auto mode : { MillingMode::Gather, MillingMode::Stamp })
+		{
+			HeightField field(material);
+			std::vector<float> removed;
+			auto error = CpuMillingEngine::Mill(field, path, params, mode, nullptr, nullptr, &removed);
+			if (error.NonCuttingContact || error.OverPlunge || error.DownMilling)
+				Error("Unexpected milling error on the test path!");
+			auto i = mode == MillingMode::Gather ? 0 : 1;
+			field.ToFloats(heights[i]);
+			volumes[i] = std::accumulate(removed.begin(), removed.end(), 0.0);
+		}
+
+		float difference = CompareHeights(heights[0], heights[1]);
+		Info("Removed {0} and {1} cm^3, heights differ by up to {2} cm", volumes[0], volumes[1], difference);
+		if (volumes[0] <= 0.0)
+			Error("The test path removed no material!");
+		if (difference > 1e-5f || std::abs(volumes[0] - volumes[1]) > 1e-4 * volumes[0])
+			Error("Gather and stamp milling do not match!");
+	}
+}
+
+void SimTests::TestMilling_FixedStepIgnoresFrameTimes()
+{
+	auto path = GetTestPath();
+	auto material = GetTestMaterial(HeightFormat::Float32, false);
+	auto params = GetTestParams(material);
+	MachineLimits limits;
+
+	// the program in windows of 20 moves, stepped the way SimSceneLayer::RunSimulation steps it: every
+	// frame's stops milled in one pass
+	struct SteppedRun
+	{
+		std::vector<ar::mat::Vec4> Stops;	// of all frames, without the first stop of every frame after the first
+		std::vector<uint64_t> Moves;
+		std::vector<float> FrameLengths;	// in cm along the path
+		std::vector<float> Heights;
+	};
+	auto run = [&](const std::vector<float>& frameTimes, const StepSettings& settings) {
+		std::vector<ar::mat::Vec4> window;
+		PathTable table;
+		uint64_t windowStart = 0;
+		auto load = [&](uint64_t start) {
+			// windows share their boundary point
+			if (start + 1 >= path.size())
+				return false;
+			window.assign(path.begin() + start, path.begin() + std::min<size_t>(start + 21, path.size()));
+			windowStart = start;
+			table = PathTable(window, limits);
+			return true;
+		};
+		load(0);
+		CutterStepper stepper(window, table, windowStart, [&]() { return load(windowStart + window.size() - 1); });
+
+		SteppedRun result;
+		HeightField field(material);
+		uint32_t segment = 0;
+		auto point = path[0];
+		result.Stops.emplace_back(ar::mat::ToVec3(point), 1.0f);
+		bool isRunning = true;
+		for (size_t frame = 0; isRunning; ++frame)
+		{
+			CutterSteps steps;
+			isRunning = stepper.StepFrame(frameTimes[frame % frameTimes.size()], settings, segment, point, steps);
+			float length = 0.0f;
+			for (size_t i = 1; i < steps.Stops.size(); ++i)
+				length += ar::mat::Length(ar::mat::ToVec3(steps.Stops[i]) - ar::mat::ToVec3(steps.Stops[i - 1]));
+			result.FrameLengths.push_back(length);
+			if (steps.Moves.empty())
+				continue;
+			result.Stops.insert(result.Stops.end(), steps.Stops.begin() + 1, steps.Stops.end());
+			result.Moves.insert(result.Moves.end(), steps.Moves.begin(), steps.Moves.end());
+			CpuMillingEngine::Mill(field, steps.Stops, params);
+		}
+		field.ToFloats(result.Heights);
+		return result;
+	};
+	auto compare = [](const SteppedRun& expected, const SteppedRun& actual) {
+		bool sameStops = expected.Stops.size() == actual.Stops.size() && expected.Moves == actual.Moves;
+		for (size_t i = 0; sameStops && i < expected.Stops.size(); ++i)
+			sameStops = ar::mat::ToVec3(expected.Stops[i]) == ar::mat::ToVec3(actual.Stops[i]);
+		float difference = CompareHeights(expected.Heights, actual.Heights);
+		Info("{0} stops in {1} frames, heights differ from 60 fps by up to {2} cm", actual.Stops.size(),
+			actual.FrameLengths.size(), difference);
+		if (!sameStops || difference != 0.0f)
+			Error("Fixed-step milling depends on the frame times!");
+	};
+
+	StepSettings settings;
+	settings.FixedStep = true;
+	settings.Rate = 4.0f;	// cm/s
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> jitter(1.0f / 240.0f, 1.0f / 15.0f);
+	std::vector<float> jittered(97);
+	for (auto& frameTime : jittered)
+		frameTime = jitter(random);
+	// every tenth frame is due more ticks than one frame takes, the rest of them are dropped
+	std::vector<float> stalled(10, 1.0f / 60.0f);
+	stalled.back() = 2.0f * settings.MaxTicksPerFrame / settings.TickRate;
+
+	for (bool byTime : { false, true })
+	{
+		settings.ByTime = byTime;
+		Trace("Testing fixed-step milling at different frame times, stepped by {0}...", byTime ? "time" : "length");
+		auto steady = run({ 1.0f / 60.0f }, settings);
+		for (auto& frameTimes : { jittered, std::vector<float>{ 1.0f / 144.0f, 0.2f }, stalled })
+			compare(steady, run(frameTimes, settings));
+	}
+
+	// a stalled frame takes MaxTicksPerFrame ticks, not the ones its time is due
+	settings.ByTime = false;
+	auto slow = run(stalled, settings);
+	float expected = settings.MaxTicksPerFrame * settings.Rate / settings.TickRate;
+	Info("A stalled frame moved {0} cm, {1} cm at most", slow.FrameLengths[stalled.size() - 1], expected);
+	if (std::abs(slow.FrameLengths[stalled.size() - 1] - expected) > 1e-4f)
+		Error("A stalled frame does not stop at MaxTicksPerFrame ticks!");
+}
+
+void SimTests::TestMilling_SnapshotRestoreMatchesMilling()
+{
+	auto path = GetTestPath();
+	auto moves = path.size() - 1;
+	for (auto [format, sparse] : { std::pair{ HeightFormat::Float32, false }, std::pair{ HeightFormat::Fixed16, true } })
+	{
+		auto material = GetTestMaterial(format, sparse);
+		auto params = GetTestParams(material);
+		Trace("Testing snapshot restore on {0} {1} heights...", format == HeightFormat::Float32 ? "float" : "fixed16",
+			sparse ? "sparse" : "dense");
+
+		// milled move by move like the simulation, with the heights before every move kept to compare with;
+		// the budget makes the float snapshots thin out, the fixed16 ones all fit
+		HeightField field(material);
+		HeightmapSnapshots snapshots;
+		snapshots.Reset(field, material.Size.y - material.BaseHeight, { 0, path[0] }, 64 << 10, 2);
+		std::vector<std::vector<float>> milled(moves + 1);
+		field.ToFloats(milled[0]);
+		for (size_t move = 0; move < moves; ++move)
+		{
+			CpuMillingEngine::Mill(field, { path[move], path[move + 1] }, params);
+			if (snapshots.IsDue(move + 1))
+				snapshots.Capture({ move + 1, path[move + 1] }, field);
+			field.ToFloats(milled[move + 1]);
+		}
+		Info("{0} snapshots every {1} moves, {2} bytes", snapshots.GetCount(), snapshots.GetInterval(),
+			snapshots.GetMemoryUsage());
+
+		for (size_t move : { size_t{ 0 }, size_t{ 1 }, size_t{ 7 }, moves / 3, moves / 2 + 1, moves - 1, moves })
+		{
+			HeightField restored(material);
+			auto from = snapshots.Restore(move, restored);
+			std::vector<ar::mat::Vec4> rest{ from.Point };
+			rest.insert(rest.end(), path.begin() + from.Move + 1, path.begin() + move + 1);
+			for (size_t i = 0; i + 1 < rest.size(); ++i)
+				CpuMillingEngine::Mill(restored, { rest[i], rest[i + 1] }, params);
+
+			std::vector<float> heights;
+			restored.ToFloats(heights);
+			float difference = CompareHeights(milled[move], heights);
+			Info("Seek to move {0}: restored move {1}, heights differ by up to {2} cm", move, from.Move, difference);
+			if (from.Move > move || difference != 0.0f)
+				Error("Restoring a snapshot does not match milling up to the move!");
+		}
+	}
+}
+
+void SimTests::TestMilling_StoppedTexelsCarryAcrossCalls()
+{
+	// a row cut into the base stops the texels under it, a deeper row then crosses half of them
+	std::vector<ar::mat::Vec4> path{ { -4.0f, 0.0f, 6.0f, 0.0f }, { -4.0f, 0.0f, 1.4f, 0.0f }, { 4.0f, 0.0f, 1.4f, 0.0f },
+		{ 4.0f, 0.0f, 6.0f, 0.0f }, { 4.0f, 0.3f, 6.0f, 0.0f }, { 4.0f, 0.3f, 1.2f, 0.0f }, { -4.0f, 0.3f, 1.2f, 0.0f } };
+	auto moves = path.size() - 1;
+	auto material = GetTestMaterial(HeightFormat::Float32, false);
+	auto params = GetTestParams(material);
+	for (auto mode : { MillingMode::Gather, MillingMode::Stamp })
+	{
+		Trace("Testing stopped texels across calls in {0} mode...", mode == MillingMode::Gather ? "gather" : "stamp");
+		auto mill = [&](bool keepStopped) {
+			HeightField field(material);
+			std::vector<uint32_t> stopped;
+			for (size_t move = 0; move < moves; ++move)
+				CpuMillingEngine::Mill(field, { path[move], path[move + 1] }, params, mode, nullptr, nullptr, nullptr,
+					keepStopped ? &stopped : nullptr);
+			std::vector<float> heights;
+			field.ToFloats(heights);
+			return heights;
+		};
+
+		HeightField field(material);
+		auto error = CpuMillingEngine::Mill(field, path, params, mode);
+		if (!error.NonCuttingContact && !error.OverPlunge)
+			Error("Cutting into the base was not reported!");
+		std::vector<float> whole;
+		field.ToFloats(whole);
+		float kept = CompareHeights(whole, mill(true)), dropped = CompareHeights(whole, mill(false));
+		Info("Milled move by move, heights differ by up to {0} cm, {1} cm without the stopped texels", kept, dropped);
+		if (kept != 0.0f || dropped == 0.0f)
+			Error("Stopped texels do not carry across calls!");
+
+		// a seek back to the row restores the texels stopped by the plunge along with the heights
+		field = HeightField(material);
+		std::vector<uint32_t> stopped(CpuMillingEngine::GetStoppedWordCount(material.Samples.u, material.Samples.v));
+		HeightmapSnapshots snapshots;
+		snapshots.Reset(field, material.Size.y - material.BaseHeight, { 0, path[0] }, 64 << 20, 1, &stopped);
+		for (size_t move = 0; move < moves; ++move)
+		{
+			CpuMillingEngine::Mill(field, { path[move], path[move + 1] }, params, mode, nullptr, nullptr, nullptr, &stopped);
+			snapshots.Capture({ move + 1, path[move + 1] }, field, &stopped);
+		}
+		HeightField restored(material);
+		auto from = snapshots.Restore(moves - 1, restored, &stopped);
+		CpuMillingEngine::Mill(restored, { path[from.Move], path[moves] }, params, mode, nullptr, nullptr, nullptr, &stopped);
+		std::vector<float> heights;
+		restored.ToFloats(heights);
+		float difference = CompareHeights(whole, heights);
+		Info("Restored move {0} and milled the row, heights differ by up to {1} cm", from.Move, difference);
+		if (from.Move != moves - 1 || difference != 0.0f)
+			Error("Restoring a snapshot does not restore the stopped texels!");
+	}
+}
+
+std::vector<ar::mat::Vec4> SimTests::GetTestPath()
+{
+	// rows 4 mm apart, each cut in 1 cm moves from 3 mm deep to 6 mm deep, turning outside of the stock
+	std::vector<ar::mat::Vec4> path{ { -4.0f, -2.4f, 6.0f, 0.0f } };
+	for (int row = 0; row < 13; ++row)
+	{
+		float y = -2.4f + 0.4f * row;
+		float from = row % 2 ? 4.0f : -4.0f;
+		for (int i = 0; i <= 8; ++i)
+			path.push_back({ from + (row % 2 ? -1.0f : 1.0f) * i, y, 4.7f - 0.3f * i / 8.0f, 0.0f });
+	}
+	path.push_back({ path.back().x, path.back().y, 6.0f, 0.0f });
+	return path;
+}
+
+MaterialDesc SimTests::GetTestMaterial(HeightFormat format, bool sparse)
+{
+	MaterialDesc material;
+	material.Samples = { 150, 120 };
+	material.Size = { 6.0f, 5.0f, 5.0f };
+	material.BaseHeight = 1.5f;
+	material.Format = format;
+	material.Sparse = sparse;
+	return material;
+}
+
+MillingParams SimTests::GetTestParams(const MaterialDesc& material)
+{
+	MillingParams params;
+	params.Profile = std::make_shared<const CutterProfile>(GCodeTools::GetCutter("k08"));
+	params.CutterRadius = params.Profile->GetRadius();
+	params.CutterHeight = params.Profile->GetCuttingLength();
+	params.ContactTolerance = HeightField::GetPrecision(material);
+	params.BaseHeight = material.BaseHeight;
+	params.TexelWidth = material.Size.x / (material.Samples.u - 1);
+	params.TexelHeight = material.Size.z / (material.Samples.v - 1);
+	params.OffsetX = -material.Size.x / 2.0f;
+	params.OffsetY = -material.Size.z / 2.0f;
+	return params;
+}
+
+float SimTests::CompareHeights(const std::vector<float>& a, const std::vector<float>& b)
+{
+	if (a.size() != b.size())
+		return std::numeric_limits<float>::infinity();
+	float difference = 0.0f;
+	for (size_t i = 0; i < a.size(); ++i)
+		difference = std::max(difference, std::abs(a[i] - b[i]));
+	return difference;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <fmt/format.h>
+#include "ARMAT.h"
+#include "Milling/MaterialDesc.h"
+#include "Milling/MillingParams.h"
+
+// Checks of the CPU milling engine on a small stock, run like ar::Tests: each one prints what it
+// compares and reports a mismatch as an error. They live next to the simulator, which the engine's
+// suite can not link against, and print to stdout rather than the engine's log, so the headless
+// SIMBATCH runs them too (SIMBATCH --self-test).
+class SimTests
+{
+public:
+	// true when every check passed
+	static bool TestMillingSuite();
+
+	static void TestMilling_GatherMatchesStamp();
+	static void TestMilling_FixedStepIgnoresFrameTimes();
+	static void TestMilling_SnapshotRestoreMatchesMilling();
+	static void TestMilling_StoppedTexelsCarryAcrossCalls();
+
+private:
+	static uint32_t s_Failures;	// of the running suite
+
+	template <typename... Args>
+	static void Trace(fmt::format_string<Args...> format, Args&&... args)
+	{
+		std::fputs((fmt::format(format, std::forward<Args>(args)...) + "\n").c_str(), stdout);
+	}
+	template <typename... Args>
+	static void Info(fmt::format_string<Args...> format, Args&&... args)
+	{
+		std::fputs(("  " + fmt::format(format, std::forward<Args>(args)...) + "\n").c_str(), stdout);
+	}
+	template <typename... Args>
+	static void Error(fmt::format_string<Args...> format, Args&&... args)
+	{
+		++s_Failures;
+		std::fputs(("error: " + fmt::format(format, std::forward<Args>(args)...) + "\n").c_str(), stderr);
+	}
+
+	// raster over the stock, every row ramping down and entered from outside of it
+	static std::vector<ar::mat::Vec4> GetTestPath();
+	static MaterialDesc GetTestMaterial(HeightFormat format, bool sparse);
+	// mirrors Heightmap::GetParams
+	static MillingParams GetTestParams(const MaterialDesc& material);
+	// largest height difference, in cm
+	static float CompareHeights(const std::vector<float>& a, const std::vector<float>& b);
+};
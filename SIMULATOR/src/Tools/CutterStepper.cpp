@@ -0,0 +1,73 @@
+#include "CutterStepper.h"
+#include <algorithm>
+
+CutterStepper::CutterStepper(const std::vector<ar::mat::Vec4>& path, const PathTable& table, const uint64_t& windowStart,
+	LoadNextWindow loadNext)
+	: m_Path(path), m_Table(table), m_WindowStart(windowStart), m_LoadNext(std::move(loadNext))
+{
+}
+
+bool CutterStepper::StepFrame(float dt, const StepSettings& settings, uint32_t& segment, ar::mat::Vec4& point,
+	CutterSteps& steps)
+{
+	steps.Stops.assign(1, { ar::mat::ToVec3(point), 1.0f });
+	steps.Moves.clear();
+	steps.MachiningTime = 0.0;
+	if (!settings.FixedStep)
+		return Advance(settings.Rate * dt, settings.ByTime, segment, point, steps);
+
+	// whole ticks, each starting where the previous one ended, so the stops do not depend on the
+	// frame rate
+	m_TickTime += dt;
+	auto due = static_cast<uint32_t>(m_TickTime * settings.TickRate);
+	m_TickTime -= due / static_cast<float>(settings.TickRate);
+	bool isRunning = true;
+	for (uint32_t tick = 0; tick < std::min(due, settings.MaxTicksPerFrame) && isRunning; ++tick)
+		isRunning = Advance(settings.Rate / settings.TickRate, settings.ByTime, segment, point, steps);
+	return isRunning;
+}
+
+bool CutterStepper::Advance(float amount, bool byTime, uint32_t& segment, ar::mat::Vec4& point, CutterSteps& steps)
+{
+	// the window's table finds where the amount ends
+	if (amount <= 0.0f)
+		return true;
+	double left = amount;
+	while (true)
+	{
+		auto from = m_Table.Locate(segment, ar::mat::ToVec3(point), m_Path);
+		double target = left + (byTime ? m_Table.GetTime(from) : m_Table.GetDistance(from));
+		double end = byTime ? m_Table.GetDuration() : m_Table.GetLength();
+		if (target <= end)
+		{
+			auto to = byTime ? m_Table.AtTime(target) : m_Table.AtDistance(target);
+			steps.MachiningTime += m_Table.GetTime(to) - m_Table.GetTime(from);
+			for (auto i = from.Segment; i < to.Segment; ++i)
+			{
+				steps.Moves.push_back(m_WindowStart + i);
+				steps.Stops.emplace_back(ar::mat::ToVec3(m_Path[i + 1]), 1.0f);
+			}
+			auto q = m_Table.GetPoint(to, m_Path);
+			steps.Moves.push_back(m_WindowStart + to.Segment);
+			steps.Stops.emplace_back(q, 1.0f);
+			segment = to.Segment;
+			point = { q, 1.0f };
+			return true;
+		}
+
+		left = target - end;
+		steps.MachiningTime += m_Table.GetDuration() - m_Table.GetTime(from);
+		auto last = static_cast<uint32_t>(m_Path.size() - 1);
+		for (auto i = from.Segment; i < last; ++i)
+		{
+			steps.Moves.push_back(m_WindowStart + i);
+			steps.Stops.emplace_back(ar::mat::ToVec3(m_Path[i + 1]), 1.0f);
+		}
+		segment = last;
+		if (!m_LoadNext())
+			return false;
+		// the new window starts at the current position
+		segment = 0;
+		point = m_Path[0];
+	}
+}
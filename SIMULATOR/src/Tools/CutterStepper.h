@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "ARMAT.h"
+#include "PathTable.h"
+
+// Stops of one frame: where the cutter was, then every point it passed, each after the first with
+// the program move it lies on
+struct CutterSteps
+{
+	std::vector<ar::mat::Vec4> Stops;
+	std::vector<uint64_t> Moves;
+	double MachiningTime = 0.0;	// in s at the programmed feeds
+};
+
+// How far the cutter goes in a frame
+struct StepSettings
+{
+	float Rate = 1.0f;		// in cm per s, or machine seconds per s when by time
+	bool ByTime = false;
+	bool FixedStep = false;	// whole ticks of the rate instead of the frame's time
+	uint32_t TickRate = 120;
+	uint32_t MaxTicksPerFrame = 32;
+};
+
+// Moves the cutter along a program window by window, by path length or by time at the programmed
+// feeds. Nothing in it renders, so the simulation and its tests step the cutter the same way.
+class CutterStepper
+{
+public:
+	// swaps the next window into the path, table and start the stepper was given, false at the end of the program
+	using LoadNextWindow = std::function<bool()>;
+
+	CutterStepper(const std::vector<ar::mat::Vec4>& path, const PathTable& table, const uint64_t& windowStart,
+		LoadNextWindow loadNext);
+
+	// the steps of a frame dt s long from the segment and point, which move along; false once the program
+	// ends. With fixed steps, the ticks due are taken whole and those past MaxTicksPerFrame are dropped.
+	bool StepFrame(float dt, const StepSettings& settings, uint32_t& segment, ar::mat::Vec4& point, CutterSteps& steps);
+	// amount further along the path, also across windows; false once the program ends
+	bool Advance(float amount, bool byTime, uint32_t& segment, ar::mat::Vec4& point, CutterSteps& steps);
+
+private:
+	const std::vector<ar::mat::Vec4>& m_Path;
+	const PathTable& m_Table;
+	const uint64_t& m_WindowStart;
+	LoadNextWindow m_LoadNext;
+	float m_TickTime = 0.0f;	// in s, not yet spent on whole ticks
+};
@@ -0,0 +1,131 @@
+#include "GCodeParser.h"
+#include "GCodeTools.h"
+#include <charconv>
+#include <fmt/format.h>
+
+bool GCodeParser::Parse(std::string_view text, std::vector<ar::mat::Vec4>& points)
+{
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		size_t end = text.find('\n', pos);
+		if (end == std::string_view::npos)
+			end = text.size();
+		m_Line++;
+		if (!ParseLine(text.substr(pos, end - pos), points))
+			return false;
+		pos = end + 1;
+	}
+	return true;
+}
+
+bool GCodeParser::ParseLine(std::string_view line, std::vector<ar::mat::Vec4>& points)
+{
+	// X, Y, Z, I, J, K in that order
+	float words[6] = {};
+	uint32_t present = 0;
+	const char* data = line.data();
+	size_t i = 0;
+	while (i < line.size())
+	{
+		char c = line[i];
+		if (c == ' ' || c == '\t' || c == '\r')
+		{
+			i++;
+			continue;
+		}
+		if (c == ';' || c == '%')
+			break;
+		if (c == '(')
+		{
+			auto close = line.find(')', i);
+			if (close == std::string_view::npos)
+				return Fail(i, "unterminated comment");
+			i = close + 1;
+			continue;
+		}
+
+		char letter = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+		if (letter < 'A' || letter > 'Z')
+			return Fail(i, fmt::format("unexpected character '{}'", c));
+		size_t wordStart = i++;
+		if (i < line.size() && line[i] == '+')
+			i++;
+		float value;
+		auto [ptr, ec] = std::from_chars(data + i, data + line.size(), value);
+		if (ec != std::errc())
+			return Fail(wordStart, fmt::format("expected a number after '{}'", letter));
+		i = ptr - data;
+
+		switch (letter)
+		{
+		case 'G':
+		{
+			int code = static_cast<int>(value);
+			if (code != value)
+				break;	// G-codes with a fraction do not affect the simulation
+			if (code >= 0 && code <= 3)
+				m_Motion = code;
+			else if (code == 17)
+				m_Plane = Plane::XY;
+			else if (code == 18)
+				m_Plane = Plane::ZX;
+			else if (code == 19)
+				m_Plane = Plane::YZ;
+			break;
+		}
+		case 'X': case 'Y': case 'Z':
+		{
+			int index = letter - 'X';
+			words[index] = value;
+			present |= 1u << index;
+			break;
+		}
+		case 'F':
+			if (value <= 0.0f)
+				return Fail(wordStart, "feed must be positive");
+			m_Feed = value;
+			break;
+		case 'I': case 'J': case 'K':
+		{
+			int index = 3 + letter - 'I';
+			words[index] = value;
+			present |= 1u << index;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	if (!(present & 0b111))
+		return true;	// nothing moves
+
+	// modal axes, converted from mm to cm
+	auto start = m_Position;
+	if (present & 0b001) m_Position.x = words[0] / 10.0f;
+	if (present & 0b010) m_Position.y = words[1] / 10.0f;
+	if (present & 0b100) m_Position.z = words[2] / 10.0f;
+	m_Position.w = m_Motion == 0 ? s_RapidFeed : m_Feed;
+
+	if (m_Motion == 2 || m_Motion == 3)
+	{
+		if (m_Plane == Plane::YZ)
+			return Fail(0, "arcs in the YZ plane (G19) are not supported");
+		if (!(present & 0b111000))
+			return Fail(0, "arc without I/J/K center offsets");
+		ar::mat::Vec3 center(words[3] / 10.0f, words[4] / 10.0f, words[5] / 10.0f);
+		GCodeTools::AppendArc(points, start, m_Position, center, m_Motion == 2, m_Plane == Plane::ZX);
+	}
+	else
+		points.push_back(m_Position);
+	return true;
+}
+
+bool GCodeParser::Fail(size_t column, std::string message)
+{
+	m_Error.Line = m_Line;
+	m_Error.Column = column + 1;
+	m_Error.Message = std::move(message);
+	return false;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ARMAT.h"
+
+struct GCodeParseError
+{
+	size_t Line = 0, Column = 0;	// 1-based
+	std::string Message;
+};
+
+// Single-pass G-code reader producing machine points in cm. Keeps the modal state (motion,
+// plane, feed, last X/Y/Z) between calls, so a program can be fed in pieces made of whole lines.
+// Comments, block numbers and words the simulator does not use (S, T, M, ...) are skipped.
+// The w of a point is the feed of the move ending there: F in mm/min, s_RapidFeed for G00 and
+// 0 before the first F.
+class GCodeParser
+{
+public:
+	static constexpr float s_RapidFeed = -1.0f;
+
+	// false on the first malformed word, points parsed before it are kept
+	bool Parse(std::string_view text, std::vector<ar::mat::Vec4>& points);
+	inline const GCodeParseError& GetError() const { return m_Error; }
+	inline size_t GetLineCount() const { return m_Line; }
+
+private:
+	enum class Plane
+	{
+		XY,
+		ZX,
+		YZ
+	};
+
+	bool ParseLine(std::string_view line, std::vector<ar::mat::Vec4>& points);
+	bool Fail(size_t column, std::string message);
+
+	GCodeParseError m_Error;
+	size_t m_Line = 0;
+	int m_Motion = 1;
+	Plane m_Plane = Plane::XY;
+	float m_Feed = 0.0f;	// in mm/min
+	ar::mat::Vec4 m_Position{ 0.0f, 0.0f, 0.0f, 0.0f };	// axes not set by the first move stay at 0
+};
@@ -0,0 +1,108 @@
+#include "GCodeStream.h"
+#include "core/Paths/GCodeWriter.h"
+#include <algorithm>
+#include <fmt/format.h>
+#include <cstring>
+
+GCodeStream::GCodeStream(const fs::path& filepath, size_t windowSize)
+	: m_Filepath(filepath), m_File(filepath), m_WindowSize(windowSize),
+	m_Parser(std::make_unique<GCodeParser>())
+{
+	if (!m_File.IsOpen())
+	{
+		m_Error = fmt::format("Could not open {}", filepath.string());
+		return;
+	}
+	m_Data = m_File.GetView();
+
+	ar::GCodeWriter::BinaryHeader header, expected;
+	if (m_Data.size() < sizeof(header))
+		return;
+	std::memcpy(&header, m_Data.data(), sizeof(header));
+	if (header.Magic != expected.Magic)
+		return;
+
+	m_IsBinary = true;
+	m_Data.remove_prefix(sizeof(header));
+	if (header.Version != expected.Version)
+		m_Error = fmt::format("Unsupported binary toolpath version {}", header.Version);
+	else if (header.Count > m_Data.size() / sizeof(ar::mat::Vec3))	// the product could overflow
+		m_Error = fmt::format("Binary toolpath {} is truncated", filepath.filename().string());
+	else
+		m_Data = m_Data.substr(0, header.Count * sizeof(ar::mat::Vec3));
+}
+
+bool GCodeStream::NextWindow(std::vector<ar::mat::Vec4>& window)
+{
+	window.clear();
+	if (HasError() || IsFinished())
+		return false;
+
+	if (m_HasLast)
+		window.push_back(m_Last);
+	size_t carried = window.size();
+	if (m_IsBinary)
+		ReadBinary(window);
+	else
+		ReadText(window);
+	if (HasError() || window.size() == carried)
+		return false;
+
+	m_WindowIndex++;
+	if (!window.empty())
+	{
+		m_Last = window.back();
+		m_HasLast = true;
+	}
+	return true;
+}
+
+void GCodeStream::Rewind()
+{
+	if (m_IsBinary && HasError())
+		return;	// header errors are permanent
+	m_Offset = 0;
+	m_WindowIndex = 0;
+	m_HasLast = false;
+	m_Parser = std::make_unique<GCodeParser>();
+	m_Error.clear();
+}
+
+void GCodeStream::ReadText(std::vector<ar::mat::Vec4>& window)
+{
+	window.reserve(std::min(m_WindowSize, (m_Data.size() - m_Offset) / 32) + 1);	// ~32 bytes per numbered G01 block
+	// whole lines only, so the parser never sees a block cut in half; a chunk holds about as many
+	// lines as the window still has room for, so a small window ends within a line of its size
+	while (window.size() < m_WindowSize && !IsFinished())
+	{
+		size_t budget = std::clamp<size_t>((m_WindowSize - window.size()) * s_MinLineBytes, 1, s_ChunkBytes);
+		size_t end = std::min(m_Offset + budget, m_Data.size());
+		if (end < m_Data.size())
+		{
+			auto newline = m_Data.find('\n', end);
+			end = newline == std::string_view::npos ? m_Data.size() : newline + 1;
+		}
+		if (!m_Parser->Parse(m_Data.substr(m_Offset, end - m_Offset), window))
+		{
+			auto& err = m_Parser->GetError();
+			m_Error = fmt::format("{}:{}:{}: {}", m_Filepath.filename().string(), err.Line, err.Column, err.Message);
+			return;
+		}
+		m_Offset = end;
+	}
+}
+
+void GCodeStream::ReadBinary(std::vector<ar::mat::Vec4>& window)
+{
+	size_t available = (m_Data.size() - m_Offset) / sizeof(ar::mat::Vec3);
+	size_t wanted = window.size() < m_WindowSize ? m_WindowSize - window.size() : 1;
+	size_t count = std::min(available, wanted);
+	window.reserve(window.size() + count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		ar::mat::Vec3 p;
+		std::memcpy(&p, m_Data.data() + m_Offset + i * sizeof(p), sizeof(p));
+		window.emplace_back(p.x / 10.0f, p.y / 10.0f, p.z / 10.0f, 0.0f);	// convert from mm to cm, no feed
+	}
+	m_Offset += count * sizeof(ar::mat::Vec3);
+}
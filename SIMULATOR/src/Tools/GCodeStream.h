@@ -0,0 +1,51 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "ARMAT.h"
+#include "Tools/MappedFile.h"
+#include "Tools/GCodeParser.h"
+
+// Reads a G-code (or binary) program window by window, so only a bounded number of points
+// is held at once. Consecutive windows share their boundary point, no segment is lost.
+class GCodeStream
+{
+public:
+	static constexpr size_t s_DefaultWindowSize = 1 << 20;
+
+	GCodeStream(const fs::path& filepath, size_t windowSize = s_DefaultWindowSize);
+	inline bool IsOpen() const { return m_File.IsOpen(); }
+	inline bool IsFinished() const { return m_Offset >= m_Data.size(); }
+	inline bool HasError() const { return !m_Error.empty(); }
+	inline const std::string& GetError() const { return m_Error; }
+	inline size_t GetWindowIndex() const { return m_WindowIndex; }
+	// fraction of the file consumed so far
+	inline float GetProgress() const
+	{
+		return m_Data.empty() ? 1.0f : static_cast<float>(m_Offset) / m_Data.size();
+	}
+
+	// Replaces the window with the next part of the program, returns false when
+	// nothing is left or the program is malformed
+	bool NextWindow(std::vector<ar::mat::Vec4>& window);
+	void Rewind();
+
+private:
+	static constexpr size_t s_ChunkBytes = 1 << 16;
+	static constexpr size_t s_MinLineBytes = 16;	// shorter G01 blocks than this can overfill a window
+
+	void ReadText(std::vector<ar::mat::Vec4>& window);
+	void ReadBinary(std::vector<ar::mat::Vec4>& window);
+
+	fs::path m_Filepath;
+	MappedFile m_File;
+	std::string_view m_Data;	// program body, after the header for binary files
+	bool m_IsBinary = false;
+	size_t m_WindowSize;
+	size_t m_Offset = 0;
+	size_t m_WindowIndex = 0;
+	std::unique_ptr<GCodeParser> m_Parser;
+	std::string m_Error;
+	ar::mat::Vec4 m_Last;
+	bool m_HasLast = false;
+};
@@ -1,11 +1,18 @@
 #include "GCodeTools.h"
 #include "StringTools.h"
-#include <fstream>
-#include <iterator>
+#include "GCodeStream.h"
+#include <limits>
+#include <numbers>
+#include <cmath>
 
-CutterType GCodeTools::GetCutterType(std::string filename)
+CutterDesc GCodeTools::GetCutter(std::string extension)
 {
-	return filename[0] == 'k' ? CutterType::ROUND : CutterType::FLAT;
+	// the cutting length is not encoded, it defaults to the diameter
+	CutterDesc cutter;
+	cutter.Shape = extension[0] == 'k' ? CutterShape::Ball : CutterShape::Flat;
+	cutter.Diameter = static_cast<float>(GetCutterSize(extension));
+	cutter.CuttingLength = cutter.Diameter;
+	return cutter;
 }
 
 double GCodeTools::GetCutterSize(std::string filename)
@@ -14,42 +21,55 @@ double GCodeTools::GetCutterSize(std::string filename)
 	return std::stod(n);
 }
 
-std::vector<ar::mat::Vec4> GCodeTools::LoadCoords(fs::path filepath)
+std::vector<ar::mat::Vec4> GCodeTools::LoadCoords(fs::path filepath, std::string& error)
 {
+	// a single window holding the whole program
 	std::vector<ar::mat::Vec4> points;
-	auto lines = ReadFile(filepath);
-	for (auto& line : lines)
-	{
-		auto tokens = ParseLine(line);
-		float x = std::stof(tokens[2]) / 10.0;	// convert from mm to cm
-		float y = std::stof(tokens[3]) / 10.0;
-		float z = std::stof(tokens[4]) / 10.0;
-		points.emplace_back(x, y, z, 1.0f);
-	}
+	GCodeStream stream(filepath, std::numeric_limits<size_t>::max());
+	stream.NextWindow(points);
+	error = stream.GetError();
 	return points;
 }
 
-std::vector<std::string> GCodeTools::ReadFile(fs::path filepath)
+void GCodeTools::AppendArc(std::vector<ar::mat::Vec4>& points, ar::mat::Vec4 start, ar::mat::Vec4 end,
+	ar::mat::Vec3 centerOffset, bool clockwise, bool planeZX)
 {
-	std::vector<std::string> lines;
-	std::ifstream infile(filepath);
-	std::string line;
-	while (std::getline(infile, line))
-		lines.push_back(line);
-	infile.close();
-	return lines;
-}
+	// every point keeps the move's feed in w; (u, v) follow the G17 (X, Y) and G18 (Z, X) axis order, w is the axis along the arc's normal
+	auto u = [planeZX](const ar::mat::Vec4& p) -> double { return planeZX ? p.z : p.x; };
+	auto v = [planeZX](const ar::mat::Vec4& p) -> double { return planeZX ? p.x : p.y; };
+	auto w = [planeZX](const ar::mat::Vec4& p) -> double { return planeZX ? p.y : p.z; };
+	double cu = u(start) + (planeZX ? centerOffset.z : centerOffset.x);
+	double cv = v(start) + (planeZX ? centerOffset.x : centerOffset.y);
 
-std::vector<std::string> GCodeTools::ParseLine(std::string line)
-{
-	std::vector<std::string> result;
-	std::string tmp(line);
-	std::array<char, 5> delims = { 'Z', 'Y', 'X', 'G', 'N'};
-	for (char & delim : delims)
+	double startAngle = std::atan2(v(start) - cv, u(start) - cu);
+	double endAngle = std::atan2(v(end) - cv, u(end) - cu);
+	double startRadius = std::hypot(u(start) - cu, v(start) - cv);
+	double endRadius = std::hypot(u(end) - cu, v(end) - cv);
+	double sweep = endAngle - startAngle;
+	if (clockwise && sweep >= 0.0)
+		sweep -= 2.0 * std::numbers::pi;
+	else if (!clockwise && sweep <= 0.0)
+		sweep += 2.0 * std::numbers::pi;
+
+	// step keeping the chord within the tolerance from the arc
+	double radius = std::max(startRadius, endRadius);
+	double step = s_MaxArcStep * std::numbers::pi / 180.0;
+	if (radius > s_ArcTolerance)
+		step = std::min(step, 2.0 * std::acos(1.0 - s_ArcTolerance / radius));
+	int count = std::max(1, static_cast<int>(std::ceil(std::abs(sweep) / step)));
+
+	points.reserve(points.size() + count);
+	for (int i = 1; i < count; ++i)
 	{
-		auto tokens = StringTools::Tokenize(tmp, delim);
-		result.insert(result.begin(), tokens.back());
-		tmp = tokens.front();
+		double t = static_cast<double>(i) / count;
+		double angle = startAngle + sweep * t;
+		double r = startRadius + (endRadius - startRadius) * t;
+		double pu = cu + r * std::cos(angle), pv = cv + r * std::sin(angle);
+		double pw = w(start) + (w(end) - w(start)) * t;
+		if (planeZX)
+			points.emplace_back(static_cast<float>(pv), static_cast<float>(pw), static_cast<float>(pu), end.w);
+		else
+			points.emplace_back(static_cast<float>(pu), static_cast<float>(pv), static_cast<float>(pw), end.w);
 	}
-	return result;
+	points.push_back(end);
 }
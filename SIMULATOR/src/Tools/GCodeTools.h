@@ -1,6 +1,6 @@
 #pragma once
 #include <string>
-#include "Milling/CutterType.h"
+#include "Milling/CutterDesc.h"
 #include "ARMAT.h"
 #include <filesystem>
 
@@ -9,11 +9,18 @@ namespace fs = std::filesystem;
 class GCodeTools
 {
 public:
-	static CutterType GetCutterType(std::string filename);
+	// the extension names the cutter: .k16 is a 16 mm ball end, .f10 a 10 mm flat one;
+	// throws if no diameter follows the letter
+	static CutterDesc GetCutter(std::string extension);
 	static double GetCutterSize(std::string filename);
-	static std::vector<ar::mat::Vec4> LoadCoords(fs::path filepath);
-	static std::vector<std::string> ReadFile(fs::path filepath);
-	static std::vector<std::string> ParseLine(std::string line);
+	// error is left empty on success; points read before a parse error are still returned
+	static std::vector<ar::mat::Vec4> LoadCoords(fs::path filepath, std::string& error);
+	// Tessellates a G02/G03 move into points; the center offset is relative to the start,
+	// in the XY plane (I, J) or in the ZX plane (I along X, K along Z)
+	static void AppendArc(std::vector<ar::mat::Vec4>& points, ar::mat::Vec4 start, ar::mat::Vec4 end,
+		ar::mat::Vec3 centerOffset, bool clockwise, bool planeZX);
 private:
+	static constexpr double s_ArcTolerance = 0.001;	// max chord deviation in cm
+	static constexpr double s_MaxArcStep = 5.0;		// in degrees
 
 };
\ No newline at end of file
@@ -1,69 +1,320 @@
 #include "Heightmap.h"
+#include "Milling/CpuMillingEngine.h"
+#include <chrono>
 
 Heightmap::Heightmap(const MaterialDesc& material, std::vector<ar::mat::Vec4> pathCoords)
-	: m_SamplesX(material.Samples.u), m_SamplesY(material.Samples.v),
+	: m_Material(material), m_SamplesX(material.Samples.u), m_SamplesY(material.Samples.v),
 	m_SizeX(material.Size.x), m_SizeY(material.Size.z), m_PathCoords(pathCoords),
 	m_PathBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<ar::mat::Vec4>>>()),
-	m_ErrorFlagsBuffer(std::make_shared<ar::ShaderStorageBuffer<MillingError>>())
+	m_ErrorFlagsBuffer(std::make_shared<ar::ShaderStorageBuffer<MillingError>>()),
+	m_BinOffsetsBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<uint32_t>>>()),
+	m_BinSegmentsBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<uint32_t>>>()),
+	m_ErrorRecordsBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<MillingErrorRecord>>>()),
+	m_SegmentErrorsBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<uint32_t>>>()),
+	m_SegmentRemovalBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<uint32_t>>>()),
+	m_ProfileBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<float>>>()),
+	m_StoppedBuffer(std::make_shared<ar::ShaderStorageBuffer<std::vector<uint32_t>>>())
 {
-	ar::TextureDesc desc{};
-	desc.Format = ar::TextureFormat::R32F;
-	desc.Width = material.Samples.u;
-	desc.Height = material.Samples.v;
-	m_Texture = ar::Ref<ar::Texture>(ar::Texture::Create(desc));
-	auto height = material.Size.y - material.BaseHeight;
-	std::vector<float> initData(desc.Width * desc.Height, height);
-	m_Texture->UpdateData(initData.data(), desc.Width * desc.Height);
-	m_CompShader = ar::Ref<ar::ComputeShader>(ar::ComputeShader::Create("resources/shaders/OpenGL/milling.comp"));
+	// counter followed by the fixed-capacity record array
+	m_ErrorRecordsBuffer->UpdateData(nullptr, s_ErrorRecordsOffset + MillingErrorLog::s_Capacity * sizeof(MillingErrorRecord));
+	ResetStoppedTexels();
+	CreateTexture(material);
+}
+
+void Heightmap::SetBackend(MillingBackend backend)
+{
+	if (backend == m_Backend)
+		return;
+	// the texture always holds the latest heights, the CPU copy is fetched only when needed
+	if (backend == MillingBackend::CPU)
+	{
+		m_Heights = HeightField(m_Material);
+		ReadTexture(m_Heights);
+		ReadStoppedTexels(m_StoppedTexels);
+	}
+	else
+	{
+		m_Heights = {};
+		m_StoppedBuffer->UpdateData(m_StoppedTexels.data(), m_StoppedTexels.size() * sizeof(uint32_t));
+	}
+	m_Backend = backend;
 }
 
 void Heightmap::ResetMap(const MaterialDesc& newMaterial)
 {
+	bool formatChanged = newMaterial.Format != m_Material.Format;
+	m_Material = newMaterial;
 	m_SamplesX = newMaterial.Samples.u;
 	m_SamplesY = newMaterial.Samples.v;
 	m_SizeX = newMaterial.Size.x;
 	m_SizeY = newMaterial.Size.z;
+	ResetStoppedTexels();
+	if (formatChanged)
+	{
+		CreateTexture(newMaterial);
+		return;
+	}
 
-	auto height = newMaterial.Size.y - newMaterial.BaseHeight;
-	std::vector<float> initData(newMaterial.Samples.u * newMaterial.Samples.v, height);
+	HeightField initData(newMaterial);
 	m_Texture->Resize(m_SamplesX, m_SamplesY);
-	m_Texture->UpdateData(initData.data(), newMaterial.Samples.u * newMaterial.Samples.v);
+	UploadHeights(initData);
+	m_HeightScale = initData.GetScale();
+	if (m_Backend == MillingBackend::CPU)
+		m_Heights = std::move(initData);
 }
-MillingError Heightmap::UpdateMap(CutterType cutterType, float cutterRadius, float cutterHeight,
-	float baseHeight)
+
+void Heightmap::CreateTexture(const MaterialDesc& material)
 {
-	MillingError initial = {};
-	
-	m_PathBuffer->UpdateData(m_PathCoords.data(), m_PathCoords.size() * sizeof(ar::mat::Vec4));
-	m_ErrorFlagsBuffer->UpdateData(&initial, sizeof(initial));
-	auto pathSegments = static_cast<unsigned int>(m_PathCoords.size() - 1);
-	bool isFlat = cutterType == CutterType::FLAT;
+	// a texture and a milling shader per height format
+	bool fixed = material.Format == HeightFormat::Fixed16;
+	ar::TextureDesc desc{};
+	desc.Format = fixed ? ar::TextureFormat::R16 : ar::TextureFormat::R32F;
+	desc.Width = material.Samples.u;
+	desc.Height = material.Samples.v;
+	m_Texture = ar::Ref<ar::Texture>(ar::Texture::Create(desc));
+	HeightField initData(material);
+	UploadHeights(initData);
+	m_HeightScale = initData.GetScale();
+	if (m_Backend == MillingBackend::CPU)
+		m_Heights = std::move(initData);
 
-	m_Texture->BindImageUnit(0, GL_READ_WRITE);
-	m_PathBuffer->Bind(1);
-	m_ErrorFlagsBuffer->Bind(2);
-	m_CompShader->SetUInt("u_PathSegments", pathSegments);
-	m_CompShader->SetFloat("u_BaseHeight", baseHeight);
-	m_CompShader->SetFloat("u_CutterRadius", cutterRadius);
-	m_CompShader->SetFloat("u_CutterHeight", cutterHeight);
-	m_CompShader->SetBool("u_IsCutterFlat", isFlat);
-	m_CompShader->SetFloat("u_TexelWidth", m_SizeX / (m_SamplesX - 1));
-	m_CompShader->SetFloat("u_TexelHeight", m_SizeY / (m_SamplesY - 1));
-	m_CompShader->SetFloat("u_OffsetX", -m_SizeX / 2.0f);
-	m_CompShader->SetFloat("u_OffsetY", -m_SizeY / 2.0f);
-
-	ar::RenderCommand::DispatchCompute(m_CompShader, (m_SamplesX + 15) / 16, (m_SamplesY + 15) / 16, 1);
-	ar::RenderCommand::MemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	std::vector<std::string> defines;
+	if (fixed)
+		defines.push_back("FIXED16_HEIGHTS");
+	m_CompShader = ar::Ref<ar::ComputeShader>(ar::ComputeShader::Create("resources/shaders/OpenGL/milling.comp", defines));
+}
 
-	// check errors
+void Heightmap::ReadHeights(HeightField& heights) const
+{
+	if (m_Backend == MillingBackend::CPU)
+	{
+		heights = m_Heights;
+		return;
+	}
+	if (heights.GetFormat() != m_Material.Format || heights.IsSparse() != m_Material.Sparse ||
+		heights.GetCount() != static_cast<size_t>(m_SamplesX) * m_SamplesY)
+		heights = HeightField(m_Material);
+	ReadTexture(heights);
+}
+
+void Heightmap::LoadHeights(const HeightField& heights)
+{
+	UploadHeights(heights);
+	if (m_Backend == MillingBackend::CPU)
+		m_Heights = heights;
+}
+
+void Heightmap::ResetStoppedTexels()
+{
+	m_StoppedTexels.assign(CpuMillingEngine::GetStoppedWordCount(m_SamplesX, m_SamplesY), 0);
+	m_StoppedBuffer->UpdateData(m_StoppedTexels.data(), m_StoppedTexels.size() * sizeof(uint32_t));
+}
+
+void Heightmap::ReadStoppedTexels(std::vector<uint32_t>& stopped) const
+{
+	if (m_Backend == MillingBackend::CPU)
+	{
+		stopped = m_StoppedTexels;
+		return;
+	}
+	stopped.resize(CpuMillingEngine::GetStoppedWordCount(m_SamplesX, m_SamplesY));
+	m_StoppedBuffer->ReadData(stopped.data(), stopped.size() * sizeof(uint32_t));
+}
+
+void Heightmap::LoadStoppedTexels(const std::vector<uint32_t>& stopped)
+{
+	if (stopped.size() != CpuMillingEngine::GetStoppedWordCount(m_SamplesX, m_SamplesY))
+	{
+		ResetStoppedTexels();
+		return;
+	}
+	m_StoppedTexels = stopped;
+	m_StoppedBuffer->UpdateData(m_StoppedTexels.data(), m_StoppedTexels.size() * sizeof(uint32_t));
+}
+
+void Heightmap::ReadTexture(HeightField& heights) const
+{
+	if (!heights.IsSparse())
+	{
+		m_Texture->ReadData(heights.GetData(), static_cast<uint32_t>(heights.GetByteSize()));
+		return;
+	}
+	// the texture is always dense, only the tiles that differ from the fill are kept
+	std::vector<uint8_t> texels(heights.GetByteSize());
+	m_Texture->ReadData(texels.data(), static_cast<uint32_t>(texels.size()));
+	heights.LoadData(texels.data());
+}
+
+void Heightmap::UploadHeights(const HeightField& heights)
+{
+	if (!heights.IsSparse())
+	{
+		m_Texture->UpdateData(const_cast<void*>(heights.GetData()));
+		return;
+	}
+	auto fill = heights.GetTexelWords(heights.GetFill());
+	m_Texture->Clear(fill.data());
+	UploadTiles(heights, { 0, 0, m_SamplesX, m_SamplesY });
+}
+
+void Heightmap::UploadTiles(const HeightField& heights, const TexelRect& rect)
+{
+	uint32_t tilesX = (m_SamplesX + HeightField::s_TileSize - 1) / HeightField::s_TileSize;
+	for (uint32_t y = rect.MinY / HeightField::s_TileSize; y * HeightField::s_TileSize < rect.MaxY; ++y)
+		for (uint32_t x = rect.MinX / HeightField::s_TileSize; x * HeightField::s_TileSize < rect.MaxX; ++x)
+		{
+			size_t tile = static_cast<size_t>(y) * tilesX + x;
+			// tiles still at the fill height match the texture already
+			if (auto words = heights.GetChunk(tile))
+			{
+				auto tileRect = heights.GetChunkRect(tile);
+				m_Texture->UpdateBlock(words, tileRect.MinX, tileRect.MinY, tileRect.GetWidth(), tileRect.GetHeight(),
+					HeightField::s_TileSize);
+			}
+		}
+}
+
+MillingError Heightmap::UpdateMap(const CutterDesc& cutter, float baseHeight)
+{
+	UpdateProfile(cutter);
+	auto params = GetParams(baseHeight);
+	auto start = std::chrono::steady_clock::now();
 	MillingError result;
-	m_ErrorFlagsBuffer->ReadData(&result, sizeof(result));
+	if (m_Backend == MillingBackend::CPU)
+	{
+		// only the block the path swept changed, the rest of the texture is already up to date
+		TexelRect dirty;
+		result = CpuMillingEngine::Mill(m_Heights, m_PathCoords, params, m_Mode, &dirty, &m_ErrorLog, &m_RemovedVolumes,
+			&m_StoppedTexels);
+		if (m_Heights.IsSparse())
+			UploadTiles(m_Heights, dirty);
+		else if (!dirty.IsEmpty())
+			m_Texture->UpdateRegion(m_Heights.GetData(), dirty.MinX, dirty.MinY, dirty.GetWidth(), dirty.GetHeight());
+	}
+	else
+	{
+		MillingError initial = {};
+		uint32_t noRecords = 0;
+		m_ErrorFlagsBuffer->UpdateData(&initial, sizeof(initial));
+		m_ErrorRecordsBuffer->UpdateSubData(&noRecords, 0, sizeof(noRecords));
+		DispatchGPU(params);
+		// reading the flags waits for the dispatch, so the timing below covers it
+		m_ErrorFlagsBuffer->ReadData(&result, sizeof(result));
+		ReadErrorLog(result);
+		ReadRemovedVolumes(params);
+	}
+	m_LastUpdateTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// check errors
 	if (result.DownMilling) AR_ERROR("Down milling detected");
 	if (result.NonCuttingContact) AR_ERROR("Non-cutting part contact detected");
 	if (result.OverPlunge) AR_ERROR("Cutter drilling into base detected");
 	return result;
 }
 
+void Heightmap::DispatchGPU(const MillingParams& params)
+{
+	m_Bins.Build(m_PathCoords, m_SamplesX, m_SamplesY, params, s_WorkGroupSize);
+	m_RemovedVolumes.assign(m_PathCoords.size() > 1 ? m_PathCoords.size() - 1 : 0, 0.0f);
+	if (m_Bins.IsEmpty())
+		return;	// no segment reaches the stock
+
+	auto& offsets = m_Bins.GetOffsets();
+	auto& indices = m_Bins.GetIndices();
+	m_PathBuffer->UpdateData(m_PathCoords.data(), m_PathCoords.size() * sizeof(ar::mat::Vec4));
+	m_BinOffsetsBuffer->UpdateData(offsets.data(), offsets.size() * sizeof(uint32_t));
+	m_BinSegmentsBuffer->UpdateData(indices.data(), indices.size() * sizeof(uint32_t));
+	std::vector<uint32_t> segmentErrors(m_PathCoords.size() - 1, 0);
+	m_SegmentErrorsBuffer->UpdateData(segmentErrors.data(), segmentErrors.size() * sizeof(uint32_t));
+	std::vector<uint32_t> segmentRemoval(2 * (m_PathCoords.size() - 1), 0);
+	m_SegmentRemovalBuffer->UpdateData(segmentRemoval.data(), segmentRemoval.size() * sizeof(uint32_t));
+
+	m_Texture->BindImageUnit(0, GL_READ_WRITE);
+	m_PathBuffer->Bind(1);
+	m_ErrorFlagsBuffer->Bind(2);
+	m_BinOffsetsBuffer->Bind(3);
+	m_BinSegmentsBuffer->Bind(4);
+	m_ErrorRecordsBuffer->Bind(5);
+	m_SegmentErrorsBuffer->Bind(6);
+	m_SegmentRemovalBuffer->Bind(7);
+	m_ProfileBuffer->Bind(8);
+	m_StoppedBuffer->Bind(9);
+	m_CompShader->SetUInt("u_ErrorCapacity", MillingErrorLog::s_Capacity);
+	m_CompShader->SetFloat("u_RemovalScale", s_RemovalScale);
+	// workgroups cover only the tiles under the path, starting at the bins' origin
+	m_CompShader->SetUInt("u_TilesX", m_Bins.GetTilesX());
+	m_CompShader->SetUInt("u_TileOriginX", m_Bins.GetOriginX());
+	m_CompShader->SetUInt("u_TileOriginY", m_Bins.GetOriginY());
+	m_CompShader->SetUInt("u_StoppedTilesX", (m_SamplesX + HeightField::s_TileSize - 1) / HeightField::s_TileSize);
+	m_CompShader->SetFloat("u_BaseHeight", params.BaseHeight);
+	m_CompShader->SetFloat("u_HeightScale", m_HeightScale);
+	m_CompShader->SetFloat("u_CutterRadius", params.CutterRadius);
+	m_CompShader->SetFloat("u_CutterHeight", params.CutterHeight);
+	m_CompShader->SetFloat("u_ContactTolerance", params.ContactTolerance);
+	m_CompShader->SetFloat("u_ProfileScale", params.Profile->GetScale());
+	m_CompShader->SetFloat("u_TexelWidth", params.TexelWidth);
+	m_CompShader->SetFloat("u_TexelHeight", params.TexelHeight);
+	m_CompShader->SetFloat("u_OffsetX", params.OffsetX);
+	m_CompShader->SetFloat("u_OffsetY", params.OffsetY);
+
+	ar::RenderCommand::DispatchCompute(m_CompShader, m_Bins.GetTilesX(), m_Bins.GetTilesY(), 1);
+	ar::RenderCommand::MemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void Heightmap::ReadErrorLog(const MillingError& flags)
+{
+	m_ErrorLog.Clear();
+	if (!flags.NonCuttingContact && !flags.OverPlunge && !flags.DownMilling)
+		return;	// nothing was appended, skip the extra readback
+
+	uint32_t count = 0;
+	m_ErrorRecordsBuffer->ReadData(&count, sizeof(count));
+	uint32_t stored = std::min(count, MillingErrorLog::s_Capacity);
+	m_ErrorLog.Records.resize(stored);
+	m_ErrorRecordsBuffer->ReadSubData(m_ErrorLog.Records.data(), s_ErrorRecordsOffset, stored * sizeof(MillingErrorRecord));
+	m_ErrorLog.Dropped = count - stored;
+	// workgroups append in any order
+	m_ErrorLog.Deduplicate();
+}
+
+void Heightmap::ReadRemovedVolumes(const MillingParams& params)
+{
+	if (m_Bins.IsEmpty())
+		return;	// nothing was dispatched, the volumes are already zero
+	std::vector<uint32_t> removal(2 * m_RemovedVolumes.size());
+	m_SegmentRemovalBuffer->ReadData(removal.data(), removal.size() * sizeof(uint32_t));
+	double unitVolume = static_cast<double>(params.TexelWidth) * params.TexelHeight / s_RemovalScale;
+	for (size_t i = 0; i < m_RemovedVolumes.size(); ++i)
+	{
+		auto units = (static_cast<uint64_t>(removal[2 * i + 1]) << 32) | removal[2 * i];
+		m_RemovedVolumes[i] = static_cast<float>(units * unitVolume);
+	}
+}
+
+void Heightmap::UpdateProfile(const CutterDesc& cutter)
+{
+	if (m_Profile && m_Profile->GetCutter() == cutter)
+		return;
+	m_Profile = std::make_shared<const CutterProfile>(cutter);
+	auto& offsets = m_Profile->GetOffsets();
+	m_ProfileBuffer->UpdateData(offsets.data(), offsets.size() * sizeof(float));
+}
+
+MillingParams Heightmap::GetParams(float baseHeight) const
+{
+	MillingParams params;
+	params.Profile = m_Profile;
+	params.CutterRadius = m_Profile->GetRadius();
+	params.CutterHeight = m_Profile->GetCuttingLength();
+	params.ContactTolerance = HeightField::GetPrecision(m_Material);
+	params.BaseHeight = baseHeight;
+	params.TexelWidth = m_SizeX / (m_SamplesX - 1);
+	params.TexelHeight = m_SizeY / (m_SamplesY - 1);
+	params.OffsetX = -m_SizeX / 2.0f;
+	params.OffsetY = -m_SizeY / 2.0f;
+	return params;
+}
+
 void Heightmap::InitPathBuffer()
 {
 	m_PathBuffer->UpdateData(m_PathCoords.data(), m_PathCoords.size() * sizeof(ar::mat::Vec4));
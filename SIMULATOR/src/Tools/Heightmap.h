@@ -2,28 +2,87 @@
 #include "ARCAD.h"
 #include "ARMAT.h"
 #include "Milling/MaterialDesc.h"
-#include "Milling/CutterType.h"
+#include "Milling/HeightField.h"
+#include "Milling/CutterDesc.h"
 #include "Milling/MillingError.h"
+#include "Milling/MillingParams.h"
+#include "Milling/SegmentBins.h"
 
 class Heightmap
 {
 public:
 	Heightmap(const MaterialDesc& material, std::vector<ar::mat::Vec4> pathCoords);
 	inline const ar::Ref<ar::Texture> GetTexture() const { return m_Texture; }
+	// cm per texture texel value, 1 for R32F
+	inline float GetHeightScale() const { return m_HeightScale; }
+	// material of the last reset, the stock the heights belong to
+	inline const MaterialDesc& GetMaterial() const { return m_Material; }
+	inline MillingBackend GetBackend() const { return m_Backend; }
+	void SetBackend(MillingBackend backend);
+	// stamping only exists on the CPU, the GPU backend always gathers
+	inline void SetMode(MillingMode mode) { m_Mode = mode; }
+	inline float GetLastUpdateTime() const { return m_LastUpdateTime; }
+	// located errors of the last update, segments index the path it milled
+	inline const MillingErrorLog& GetErrorLog() const { return m_ErrorLog; }
+	// material every segment of the last update cut away, in cm^3
+	inline const std::vector<float>& GetRemovedVolumes() const { return m_RemovedVolumes; }
 	inline const void LoadNewPath(std::vector<ar::mat::Vec4> newCoords) { m_PathCoords = newCoords; }
+	inline const std::vector<ar::mat::Vec4>& GetPath() const { return m_PathCoords; }
 	
 	void ResetMap(const MaterialDesc& material);
-	MillingError UpdateMap(CutterType cutterType, float cutterRadius, float cutterHeight, float baseHeight);
+	// copies of the whole stock in the material's height format, read back from the texture on the GPU backend
+	void ReadHeights(HeightField& heights) const;
+	void LoadHeights(const HeightField& heights);
+	// texels that hit an error are not milled again until the next program, like in SIMBATCH, so
+	// the stock does not depend on how the program was split into updates; see CpuMillingEngine::Mill
+	void ResetStoppedTexels();
+	void ReadStoppedTexels(std::vector<uint32_t>& stopped) const;
+	// a mask of the wrong size clears it
+	void LoadStoppedTexels(const std::vector<uint32_t>& stopped);
+	MillingError UpdateMap(const CutterDesc& cutter, float baseHeight);
 
 private:
 	void InitPathBuffer();
+	void CreateTexture(const MaterialDesc& material);
+	// whole-stock transfers, a sparse field only sends the tiles it allocated
+	void ReadTexture(HeightField& heights) const;
+	void UploadHeights(const HeightField& heights);
+	// allocated tiles of a sparse field overlapping rect
+	void UploadTiles(const HeightField& heights, const TexelRect& rect);
+	void DispatchGPU(const MillingParams& params);
+	void ReadErrorLog(const MillingError& flags);
+	void ReadRemovedVolumes(const MillingParams& params);
+	// rebuilds the profile table and its GPU copy when the cutter changed
+	void UpdateProfile(const CutterDesc& cutter);
+	MillingParams GetParams(float baseHeight) const;
 
 	std::vector<ar::mat::Vec4> m_PathCoords;
 	ar::Ref<ar::Texture> m_Texture;
 	ar::Ref<ar::ShaderStorageBuffer<std::vector<ar::mat::Vec4>>> m_PathBuffer;
 	ar::Ref<ar::ShaderStorageBuffer<MillingError>> m_ErrorFlagsBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<uint32_t>>> m_BinOffsetsBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<uint32_t>>> m_BinSegmentsBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<MillingErrorRecord>>> m_ErrorRecordsBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<uint32_t>>> m_SegmentErrorsBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<uint32_t>>> m_SegmentRemovalBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<float>>> m_ProfileBuffer;
+	ar::Ref<ar::ShaderStorageBuffer<std::vector<uint32_t>>> m_StoppedBuffer;
+	std::shared_ptr<const CutterProfile> m_Profile;
+	static constexpr size_t s_ErrorRecordsOffset = sizeof(uint32_t);	// records follow the counter, std430
+	static constexpr float s_RemovalScale = 1e6f;	// fixed-point units per cm of removed depth on the GPU
+	MillingErrorLog m_ErrorLog;
+	std::vector<float> m_RemovedVolumes;
+	SegmentBins m_Bins;
 	ar::Ref<ar::ComputeShader> m_CompShader;
+	static constexpr uint32_t s_WorkGroupSize = 16;	// local_size of milling.comp, one bin per workgroup
+	MillingBackend m_Backend = MillingBackend::GPU;
+	MillingMode m_Mode = MillingMode::Gather;
+	float m_LastUpdateTime = 0.0f;	// in ms, includes the upload of the CPU heights
+	HeightField m_Heights;	// CPU copy of the texture, kept only for the CPU backend, sparse if the material asks
+	std::vector<uint32_t> m_StoppedTexels;	// of the CPU backend, the GPU one keeps them in m_StoppedBuffer
+	float m_HeightScale = 1.0f;
 
+	MaterialDesc m_Material;
 	uint32_t m_SamplesX, m_SamplesY;
 	float m_SizeX, m_SizeY;
 };
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "MachiningTime.h"
+#include "GCodeStream.h"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+
+MachiningTime::MachiningTime(const MachineLimits& limits)
+	: m_Limits(limits), m_Acceleration(limits.Acceleration / 10.0f), m_JunctionDeviation(limits.JunctionDeviation / 10.0f)
+{
+}
+
+void MachiningTime::Add(const std::vector<ar::mat::Vec4>& path)
+{
+	Add(PathTable(path, m_Limits));
+}
+
+void MachiningTime::Add(const PathTable& table)
+{
+	for (auto& move : table.GetSegments())
+		if (move.Length > 0.0f)
+			Plan(move);
+}
+
+const MachiningEstimate& MachiningTime::Finish()
+{
+	if (m_Pending)
+		Plan(std::nullopt);
+	return m_Estimate;
+}
+
+void MachiningTime::Plan(const std::optional<Move>& next)
+{
+	if (m_Pending)
+	{
+		auto& move = *m_Pending;
+		float exit = 0.0f;
+		if (next && m_Acceleration > 0.0f)
+		{
+			// the corner, being able to stop within the next move and what this one can reach
+			exit = std::min({ GetJunctionSpeed(move, *next), std::sqrt(2.0f * m_Acceleration * next->Length),
+				std::sqrt(m_EntrySpeed * m_EntrySpeed + 2.0f * m_Acceleration * move.Length) });
+		}
+		double time = GetMoveTime(move, m_EntrySpeed, exit);
+		if (move.Rapid)
+		{
+			m_Estimate.RapidTime += time;
+			m_Estimate.RapidLength += move.Length;
+		}
+		else
+		{
+			m_Estimate.CuttingTime += time;
+			m_Estimate.CuttingLength += move.Length;
+		}
+		m_EntrySpeed = exit;
+	}
+	else
+		m_EntrySpeed = 0.0f;
+	m_Pending = next;
+}
+
+float MachiningTime::GetJunctionSpeed(const Move& from, const Move& to) const
+{
+	float speed = std::min(from.Speed, to.Speed);
+	// cosine of the angle between the reversed incoming direction and the outgoing one
+	float cosine = -ar::mat::Dot(from.Direction, to.Direction);
+	if (cosine > 0.999999f)
+		return 0.0f;	// the cutter turns back
+	if (cosine < -0.999999f)
+		return speed;	// straight on
+	float sinHalf = std::sqrt(0.5f * (1.0f - cosine));
+	return std::min(speed, std::sqrt(m_Acceleration * m_JunctionDeviation * sinHalf / (1.0f - sinHalf)));
+}
+
+double MachiningTime::GetMoveTime(const Move& move, float entry, float exit) const
+{
+	if (m_Acceleration <= 0.0f)
+		return move.Length / move.Speed;
+	// accelerate, cruise at the feed if the move is long enough to reach it, then decelerate
+	double a = m_Acceleration, v = move.Speed;
+	double peakSquared = (2.0 * a * move.Length + static_cast<double>(entry) * entry + static_cast<double>(exit) * exit) / 2.0;
+	if (peakSquared <= v * v)
+		return (2.0 * std::sqrt(peakSquared) - entry - exit) / a;
+	double ramps = (2.0 * v * v - static_cast<double>(entry) * entry - static_cast<double>(exit) * exit) / (2.0 * a);
+	return (2.0 * v - entry - exit) / a + (move.Length - ramps) / v;
+}
+
+MachiningEstimate MachiningTime::Estimate(const fs::path& filepath, const MachineLimits& limits, std::string& error,
+	std::stop_token stop)
+{
+	MachiningTime time(limits);
+	GCodeStream stream(filepath);
+	std::vector<ar::mat::Vec4> window;
+	while (!stop.stop_requested() && stream.NextWindow(window))
+		time.Add(window);
+	error = stream.GetError();
+	return time.Finish();
+}
+
+float MachiningTime::GetSpeed(const ar::mat::Vec4& point, const MachineLimits& limits)
+{
+	float feed = point.w > 0.0f ? point.w : point.w < 0.0f ? limits.RapidFeed : limits.DefaultFeed;
+	return feed / 600.0f;	// mm/min to cm/s
+}
+
+std::string MachiningTime::Format(double seconds)
+{
+	auto minutes = static_cast<uint64_t>(seconds / 60.0);
+	double rest = seconds - minutes * 60.0;
+	if (minutes < 60)
+		return fmt::format("{}:{:04.1f}", minutes, rest);
+	return fmt::format("{}:{:02}:{:04.1f}", minutes / 60, minutes % 60, rest);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include <stop_token>
+#include "ARMAT.h"
+#include "Tools/PathTable.h"
+
+namespace fs = std::filesystem;
+
+// Speeds of the machine, in the units of the G-code
+struct MachineLimits
+{
+	float RapidFeed = 10000.0f;			// mm/min, for G00 moves
+	float DefaultFeed = 1000.0f;		// mm/min, until a program sets F; binary toolpaths carry no feed
+	float Acceleration = 0.0f;			// mm/s^2, the same on every axis; 0 changes speed instantly
+	float JunctionDeviation = 0.02f;	// mm a corner may be rounded by to keep speed through it
+};
+
+struct MachiningEstimate
+{
+	double CuttingTime = 0.0, RapidTime = 0.0;		// in s
+	double CuttingLength = 0.0, RapidLength = 0.0;	// in cm
+	inline double GetTotal() const { return CuttingTime + RapidTime; }
+};
+
+// Machining time of a program from the feeds its points carry (see GCodeParser), in one pass over
+// the moves. Without an acceleration limit every move runs at its feed. With one, each move is a
+// trapezoid: it enters at the speed the previous one left it with, and leaves at the corner speed
+// the junction deviation allows. That speed is also capped so the cutter could still stop by the
+// end of the next move, so a single move of look-ahead is enough and the estimate errs long.
+class MachiningTime
+{
+public:
+	MachiningTime(const MachineLimits& limits = {});
+
+	// the moves from path[0] on; consecutive windows of a program can be added as they are read
+	void Add(const std::vector<ar::mat::Vec4>& path);
+	// the same, from a table built with the same limits
+	void Add(const PathTable& table);
+	// the last move ends at rest
+	const MachiningEstimate& Finish();
+	inline const MachiningEstimate& GetEstimate() const { return m_Estimate; }
+
+	// reads the whole program; error is left empty on success. A stop request ends the pass after
+	// the window being read, with the estimate of the windows so far
+	static MachiningEstimate Estimate(const fs::path& filepath, const MachineLimits& limits, std::string& error,
+		std::stop_token stop = {});
+	// in cm/s, of the move ending at point, at its feed
+	static float GetSpeed(const ar::mat::Vec4& point, const MachineLimits& limits);
+	// h:mm:ss.s, or m:ss.s under an hour
+	static std::string Format(double seconds);
+
+private:
+	using Move = PathSegment;
+
+	void Plan(const std::optional<Move>& next);
+	float GetJunctionSpeed(const Move& from, const Move& to) const;
+	double GetMoveTime(const Move& move, float entry, float exit) const;
+
+	MachineLimits m_Limits;
+	float m_Acceleration, m_JunctionDeviation;	// in cm/s^2 and cm
+	MachiningEstimate m_Estimate;
+	std::optional<Move> m_Pending;	// added but not timed, its exit speed depends on the next move
+	float m_EntrySpeed = 0.0f;		// of the pending move
+};
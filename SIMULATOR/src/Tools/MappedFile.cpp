@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(const fs::path& filepath)
+{
+	HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+		return;
+	m_Size = static_cast<size_t>(size.QuadPart);
+	if (m_Size == 0)
+	{
+		// empty files cannot be mapped
+		m_IsOpen = true;
+		return;
+	}
+
+	m_Mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_Mapping)
+		return;
+	m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	m_IsOpen = m_Data != nullptr;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File)
+		CloseHandle(m_File);
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const fs::path& filepath)
+{
+	m_File = open(filepath.c_str(), O_RDONLY);
+	if (m_File < 0)
+		return;
+
+	struct stat info;
+	if (fstat(m_File, &info) != 0)
+		return;
+	m_Size = static_cast<size_t>(info.st_size);
+	if (m_Size == 0)
+	{
+		// empty files cannot be mapped
+		m_IsOpen = true;
+		return;
+	}
+
+	void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0);
+	if (data == MAP_FAILED)
+		return;
+	madvise(data, m_Size, MADV_SEQUENTIAL);
+	m_Data = static_cast<const char*>(data);
+	m_IsOpen = true;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data)
+		munmap(const_cast<char*>(m_Data), m_Size);
+	if (m_File >= 0)
+		close(m_File);
+}
+#endif
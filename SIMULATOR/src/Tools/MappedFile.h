@@ -0,0 +1,29 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile(const fs::path& filepath);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline bool IsOpen() const { return m_IsOpen; }
+	inline std::string_view GetView() const { return { m_Data, m_Size }; }
+
+private:
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_IsOpen = false;
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+};
@@ -0,0 +1,73 @@
+#include "PathTable.h"
+#include "MachiningTime.h"
+#include <algorithm>
+
+PathTable::PathTable(const std::vector<ar::mat::Vec4>& path, const MachineLimits& limits)
+{
+	size_t count = path.size() > 1 ? path.size() - 1 : 0;
+	m_Segments.reserve(count);
+	m_Distances.reserve(count + 1);
+	m_Times.reserve(count + 1);
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto delta = ar::mat::ToVec3(path[i + 1]) - ar::mat::ToVec3(path[i]);
+		float length = ar::mat::Length(delta);
+		PathSegment segment{ length > 0.0f ? delta / length : ar::mat::Vec3{ 0.0f, 0.0f, 0.0f }, length,
+			MachiningTime::GetSpeed(path[i + 1], limits), path[i + 1].w < 0.0f };
+		m_Distances.push_back(m_Distances.back() + length);
+		m_Times.push_back(m_Times.back() + length / segment.Speed);
+		m_Segments.push_back(segment);
+	}
+}
+
+PathLocation PathTable::AtDistance(double distance) const
+{
+	return Find(m_Distances, distance, false);
+}
+
+PathLocation PathTable::AtTime(double seconds) const
+{
+	return Find(m_Times, seconds, true);
+}
+
+PathLocation PathTable::Find(const std::vector<double>& sums, double value, bool byTime) const
+{
+	if (m_Segments.empty())
+		return {};
+	// the last point at or before the value starts the segment, past the end is the end of the last one
+	auto after = std::upper_bound(sums.begin(), sums.end(), value);
+	auto segment = static_cast<uint32_t>(std::clamp<ptrdiff_t>(after - sums.begin() - 1, 0, m_Segments.size() - 1));
+	auto& found = m_Segments[segment];
+	double offset = (value - sums[segment]) * (byTime ? found.Speed : 1.0f);
+	return { segment, static_cast<float>(std::clamp(offset, 0.0, static_cast<double>(found.Length))) };
+}
+
+PathLocation PathTable::Locate(uint32_t segment, const ar::mat::Vec3& point, const std::vector<ar::mat::Vec4>& path) const
+{
+	if (segment >= m_Segments.size())
+		return { segment, 0.0f };
+	auto& found = m_Segments[segment];
+	float offset = ar::mat::Dot(point - ar::mat::ToVec3(path[segment]), found.Direction);
+	return { segment, std::clamp(offset, 0.0f, found.Length) };
+}
+
+double PathTable::GetDistance(const PathLocation& location) const
+{
+	if (location.Segment >= m_Segments.size())
+		return GetLength();
+	return m_Distances[location.Segment] + location.Offset;
+}
+
+double PathTable::GetTime(const PathLocation& location) const
+{
+	if (location.Segment >= m_Segments.size())
+		return GetDuration();
+	return m_Times[location.Segment] + location.Offset / m_Segments[location.Segment].Speed;
+}
+
+ar::mat::Vec3 PathTable::GetPoint(const PathLocation& location, const std::vector<ar::mat::Vec4>& path) const
+{
+	if (location.Segment >= m_Segments.size())
+		return ar::mat::ToVec3(path[std::min<size_t>(location.Segment, path.size() - 1)]);
+	return ar::mat::ToVec3(path[location.Segment]) + m_Segments[location.Segment].Direction * location.Offset;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "ARMAT.h"
+
+struct MachineLimits;
+
+// Move from one path point to the next
+struct PathSegment
+{
+	ar::mat::Vec3 Direction;	// unit length, 0 for a move that goes nowhere
+	float Length;	// in cm
+	float Speed;	// in cm/s, at its feed
+	bool Rapid;
+};
+
+// Point on a path: the segment it lies on and how far along it, in cm
+struct PathLocation
+{
+	uint32_t Segment = 0;
+	float Offset = 0.0f;
+};
+
+// Segments of a path with running sums of their length and of the time they take at their feeds
+// (without acceleration, as the simulation plays them back). Finding the point a distance or a time
+// into the path is a binary search instead of a walk over the segments.
+class PathTable
+{
+public:
+	PathTable() = default;
+	PathTable(const std::vector<ar::mat::Vec4>& path, const MachineLimits& limits);
+
+	// clamped to the path, a location between segments lies at the start of the later one
+	PathLocation AtDistance(double distance) const;
+	PathLocation AtTime(double seconds) const;
+	// location of a point on the segment, projected onto it
+	PathLocation Locate(uint32_t segment, const ar::mat::Vec3& point, const std::vector<ar::mat::Vec4>& path) const;
+	double GetDistance(const PathLocation& location) const;
+	double GetTime(const PathLocation& location) const;
+	// path is the one the table was built from
+	ar::mat::Vec3 GetPoint(const PathLocation& location, const std::vector<ar::mat::Vec4>& path) const;
+
+	inline const std::vector<PathSegment>& GetSegments() const { return m_Segments; }
+	inline double GetLength() const { return m_Distances.back(); }
+	inline double GetDuration() const { return m_Times.back(); }
+
+private:
+	std::vector<PathSegment> m_Segments;
+	// at every point, from the first one
+	std::vector<double> m_Distances{ 0.0 }, m_Times{ 0.0 };
+
+	PathLocation Find(const std::vector<double>& sums, double value, bool byTime) const;
+};
@@ -0,0 +1,23 @@
+#include "ProgramPrefetch.h"
+#include <chrono>
+
+void ProgramPrefetch::Start(const fs::path& filepath, size_t windowSize)
+{
+	m_Filepath = filepath;
+	m_Future = std::async(std::launch::async, [filepath, windowSize]() {
+		auto start = std::chrono::steady_clock::now();
+		Program program;
+		program.Filepath = filepath;
+		program.Stream = std::make_unique<GCodeStream>(filepath, windowSize);
+		program.Stream->NextWindow(program.FirstWindow);
+		program.ParseTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return program;
+		});
+}
+
+ProgramPrefetch::Program ProgramPrefetch::Take()
+{
+	auto program = m_Future.get();
+	m_Filepath.clear();
+	return program;
+}
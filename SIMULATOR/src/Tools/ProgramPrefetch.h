@@ -0,0 +1,30 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <vector>
+#include "ARMAT.h"
+#include "Tools/GCodeStream.h"
+
+// Opens a program and parses its first window on a worker thread, so the next program of a job
+// is ready by the time the current one is milled
+class ProgramPrefetch
+{
+public:
+	struct Program
+	{
+		fs::path Filepath;
+		std::unique_ptr<GCodeStream> Stream;
+		std::vector<ar::mat::Vec4> FirstWindow;	// only valid if the stream has no error
+		float ParseTime = 0.0f;	// in ms, spent on the worker
+	};
+
+	void Start(const fs::path& filepath, size_t windowSize = GCodeStream::s_DefaultWindowSize);
+	inline bool IsStarted() const { return m_Future.valid(); }
+	inline const fs::path& GetFilepath() const { return m_Filepath; }
+	// waits for the worker if it is still parsing
+	Program Take();
+
+private:
+	std::future<Program> m_Future;
+	fs::path m_Filepath;
+};